@@ -1,21 +1,71 @@
 #pragma once
 #include "typedefs.h"
 #include "bus_constants.h"
+#include "fastmem.h"
+#include "file_image.h"
+#include "host_memory.h"
 #include <array>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <functional>
 
 namespace br::gba
 {
+    /// @brief compute an io register on read
+    /// @param _offset halfword aligned offset in the io region
+    /// @return register value
+    typedef std::function<const u16(const u32&)> io_read_callback;
+
+    /// @brief react to an io register write, byte writes only set the written byte in the mask
+    /// word writes arrive as two halfword writes, low half first
+    /// @param _offset halfword aligned offset in the io region
+    /// @param _previous stored register value
+    /// @param _data written bits, zero outside the mask
+    /// @param _mask written bits
+    /// @return value to store in the register
+    typedef std::function<const u16(const u32&, const u16&, const u16&, const u16&)> io_write_callback;
+
+    struct io_handler
+    {
+        io_read_callback read;
+        io_write_callback write;
+    };
+
+    // kind of a bus access, byte accesses cost the same as halfword accesses
+    enum struct bus_access : u32
+    {
+        NONSEQUENTIAL_16,
+        SEQUENTIAL_16,
+        NONSEQUENTIAL_32,
+        SEQUENTIAL_32
+    };
+
+    /// @brief tables compiled code accesses memory through, the pointers stay valid for the lifetime of the bus
+    struct bus_fast_paths
+    {
+        // backing memory of every page, indexed by address bits 27-14, nullptr takes the slow path
+        u8* const* readPages;
+        u8* const* writePages;
+        // arena the pages point into, it moves when fastmem is switched
+        u8* const* arena;
+        // one bit for every arena code page, writes to marked pages take the slow path
+        const u64* codePages;
+        // write generation of every arena block, a write stamps its block with memoryGeneration
+        u32* blockGenerations;
+        const u32* memoryGeneration;
+        // cycles of every bus_access, indexed by the access times MEMORY_REGION_COUNT plus address bits 27-24
+        const u8* accessCycles;
+    };
+
     class bus
     {
     public:
-        /// @brief read 32bit data from address
+        /// @brief read 32bit data from address, misaligned reads return the aligned word rotated
         /// @param _address absolute address
         /// @return 32bit data
         const u32 read_32(const u32& _address);
-        /// @brief read 16bit data from address
+        /// @brief read 16bit data from address, misaligned reads return the aligned halfword rotated
         /// @param _address absolute address
         /// @return 16bit data
         const u16 read_16(const u32& _address);
@@ -24,11 +74,11 @@ namespace br::gba
         /// @return 8bit data
         const u8 read_8(const u32& _address);
 
-        /// @brief write 32bit data to address
+        /// @brief write 32bit data to address, misaligned writes go to the aligned word
         /// @param _address absolute address
         /// @param _data 32bit data
         void write_32(const u32& _address, const u32& _data);
-        /// @brief write 16bit data to address
+        /// @brief write 16bit data to address, misaligned writes go to the aligned halfword
         /// @param _address absolute address
         /// @param _data 16bit data
         void write_16(const u32& _address, const u16& _data);
@@ -37,25 +87,273 @@ namespace br::gba
         /// @param _data 8bit data
         void write_8(const u32& _address, const u8& _data);
 
+        /// @brief read consecutive words, the low address bits are ignored like in LDM
+        /// pages with backing memory are copied whole, io registers and unmapped pages are read word by word
+        /// @param _address absolute address of the first word
+        /// @param _data receives the words
+        /// @param _count word count
+        void read_block_32(const u32& _address, u32* _data, const u32& _count);
+        /// @brief write consecutive words, the low address bits are ignored like in STM
+        /// @param _address absolute address of the first word
+        /// @param _data words to write
+        /// @param _count word count
+        void write_block_32(const u32& _address, const u32* _data, const u32& _count);
+        /// @brief read a buffer, pages without backing memory are read byte by byte
+        /// @param _address absolute address
+        /// @param _data receives the bytes
+        /// @param _size byte count
+        void read_block(const u32& _address, u8* _data, const u32& _size);
+        /// @brief write a buffer, pages without backing memory are written byte by byte
+        /// @param _address absolute address
+        /// @param _data bytes to write
+        /// @param _size byte count
+        void write_block(const u32& _address, const u8* _data, const u32& _size);
+
     public:
+        /// @brief map a bios image read only, writes to the bios are ignored afterwards
+        /// @param _filePath bios file
+        /// @return false if the file could not be mapped, the bios is back to plain memory
         const bool load_bios(const std::string& _filePath);
 
+        /// @brief map a rom image read only and mirror it across the three rom regions
+        /// @param _filePath rom file
+        /// @return false if the file could not be mapped, the rom regions are unmapped
         const bool load_rom(const std::string& _filePath);
 
         const bool debug_load_program(const std::string& _filePath);
 
         const std::string debug_print_memory(const u32& _address);
 
+    public:
+        /// @brief mark the memory behind an address as holding decoded code
+        /// @param _address absolute address
+        /// @return false if code from this address cannot be cached
+        const bool add_code_page(const u32& _address);
+
+        /// @brief get the write generation of the memory behind an address, it changes when a marked page is written to
+        /// decoded code is stale once the generation differs from the one it was decoded at
+        /// generations follow the arena, so a write through any mirror changes them for every mirror
+        /// @param _address absolute address
+        /// @return generation of the arena page, or of the read only images for everything outside the arena
+        const u32 get_code_generation(const u32& _address);
+
+        /// @brief get the word get_code_generation reads for an address, compiled code compares it without calling into the bus
+        /// @param _address absolute address
+        /// @return generation of the arena page or of the images, valid for the lifetime of the bus
+        const u32* get_code_generation_source(const u32& _address);
+
+        /// @brief get the tables compiled code inlines accesses with
+        const bus_fast_paths get_fast_paths();
+
+        /// @brief get the cycles an access takes, including the wait states set in WAITCNT
+        /// @param _address absolute address
+        /// @param _access width and whether the access follows the previous address
+        /// @return cycle count
+        const u32 get_access_cycles(const u32& _address, const bus_access& _access);
+
+        /// @brief hook an io register, registers without callbacks are plain storage
+        /// @param _address absolute address of the register, rounded down to a halfword
+        /// @param _read called instead of reading the storage, may be empty
+        /// @param _write called on every write to the register, may be empty
+        /// @return false if the address is outside the io registers
+        const bool set_io_handler(const u32& _address, const io_read_callback& _read, const io_write_callback& _write);
+
+        /// @brief get the stored value of an io register, its read handler is not called
+        /// @param _address absolute address of the register, wrapped to the io registers and rounded down to a halfword
+        /// @return stored register value
+        const u16 get_io_register(const u32& _address);
+
+        /// @brief store an io register from the hardware side, its write handler is not called
+        /// @param _address absolute address of the register, wrapped to the io registers and rounded down to a halfword
+        /// @param _data register value
+        void set_io_register(const u32& _address, const u16& _data);
+
+        /// @brief get the amount of io reads served by read handlers, their values can change without an event
+        const u32 get_io_read_count();
+
+        /// @brief move guest memory into a host view of the whole address space, reads become base plus offset
+        /// io registers and writes still go through the page table, linux only
+        /// @param _enabled use the fastmem view, otherwise guest memory is a plain allocation
+        /// @return false if the host does not support it, memory is left where it was
+        const bool set_fastmem(const bool& _enabled);
+
+        const bool get_fastmem();
+
+        /// @brief back the memory arena with huge pages, applies while fastmem is disabled, linux only
+        /// @param _enabled align the arena to a huge page and advise the os to use huge pages
+        void set_huge_pages(const bool& _enabled);
+
+        const bool get_huge_pages();
+
+    public:
+        /// @brief copy all guest memory of the arena, bios and rom images are not included
+        /// @param _state receives MEMORY_ARENA_SIZE bytes in the MEMORY_*_OFFSET layout
+        void save_memory_state(std::vector<u8>& _state);
+
+        /// @brief restore guest memory saved with save_memory_state, decoded code is invalidated
+        /// @param _state saved memory
+        /// @return false if the state does not match the arena size
+        const bool load_memory_state(const std::vector<u8>& _state);
+
+        /// @brief copy the arena blocks written since a generation into a saved state
+        /// @param _state state from save_memory_state
+        /// @param _generation generation from checkpoint_memory when the state was last updated
+        /// @return false if the state does not match the arena size
+        const bool update_memory_state(std::vector<u8>& _state, const u32& _generation);
+
+        /// @brief start a new write generation, every consumer keeps the generation of its last checkpoint
+        /// @return generation stamped on writes from now on
+        const u32 checkpoint_memory();
+
+        /// @brief get the arena blocks written since a generation
+        /// @param _generation generation from checkpoint_memory, 0 for every block ever written
+        /// @param _bitmap receives one bit per MEMORY_DIRTY_BLOCK_SIZE block, indexed by arena offset
+        void get_dirty_blocks(const u32& _generation, std::vector<u64>& _bitmap);
+
+        /// @brief test if an arena range was written since a generation
+        /// @param _offset offset in the arena
+        /// @param _size byte count, at least 1
+        const bool test_dirty(const u32& _offset, const u32& _size, const u32& _generation);
+
+    private:
+        /// @brief read from a page without backing memory
+        const u8 read_8_slow(const u32& _address);
+        /// @brief write to a page without backing memory
+        void write_8_slow(const u32& _address, const u8& _data);
+
+        /// @brief read an io register through its handler or the storage
+        /// @param _offset halfword aligned offset in the io region
+        const u16 read_io(const u32& _offset);
+        /// @brief write the masked bits of an io register through its handler or the storage
+        /// @param _offset halfword aligned offset in the io region
+        void write_io(const u32& _offset, const u16& _data, const u16& _mask);
+
+        /// @brief handle a write to WAITCNT
+        const u16 write_wait_control(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+
+        /// @brief recompute the access cycles of every region
+        /// @param _waitControl value of WAITCNT
+        void update_wait_states(const u16& _waitControl);
+
+        /// @brief set the access cycles of a region with a 16 bit bus, 32 bit accesses take two halfword accesses
+        /// @param _address absolute address of the region
+        /// @param _nonsequential cycles of a nonsequential halfword access
+        /// @param _sequential cycles of a sequential halfword access
+        void set_region_cycles(const u32& _address, const u32& _nonsequential, const u32& _sequential);
+
+        /// @brief byte wise access for misaligned addresses and pages without backing memory
+        const u32 read_32_slow(const u32& _address);
+        const u16 read_16_slow(const u32& _address);
+        void write_32_slow(const u32& _address, const u32& _data);
+        void write_16_slow(const u32& _address, const u16& _data);
+
+        /// @brief test if a read can be served from the fastmem view
+        /// @param _alignMask address bits that have to be clear
+        const bool test_fastmem_read(const u32& _address, const u32& _alignMask);
+
+        /// @brief copy a range page by page, pages without backing memory take the single access path
+        /// @tparam T access width of the single access path
+        /// @tparam WRITE copy from _data into memory, otherwise from memory into _data
+        template <typename T, bool WRITE>
+        void transfer_block(const u32& _address, u8* _data, const u32& _size);
+
+        /// @brief get the backing memory of an address
+        /// @return nullptr when the access takes the slow path
+        u8* get_read_page(const u32& _address);
+        u8* get_write_page(const u32& _address);
+
+        /// @brief get the code page of the arena memory behind an address
+        /// @param _codePage set to the arena offset in code pages
+        /// @return false if the address is not backed by the arena
+        const bool get_code_page(const u32& _address, u32& _codePage);
+
+        /// @brief advance the generation of the code page of arena memory when it is marked as code, unmarking it
+        /// @param _memory written arena memory
+        void test_code_write(const u8* _memory);
+
+        /// @brief stamp the blocks of an arena range with the current write generation
+        /// @param _memory written arena memory
+        /// @param _size byte count, at least 1
+        void mark_written(const u8* _memory, const u32& _size);
+
+        /// @brief advance the generations of the code pages of an arena range
+        /// @param _memory written arena memory
+        /// @param _size byte count, at least 1
+        void test_code_write_range(const u8* _memory, const u32& _size);
+
+        /// @brief advance the generation of every code page and of the images
+        void invalidate_code_pages();
+
+        /// @brief point the regions and the page table at a guest memory arena
+        /// @param _arena memory with the MEMORY_*_OFFSET layout
+        void bind_memory(u8* _arena);
+
+        /// @brief map the bios and rom images, or what replaces them when they are not loaded
+        void map_images();
+
+        /// @brief map the bios and rom images into the fastmem view
+        /// @return false if the view could not be mapped
+        const bool map_fastmem_images();
+
+        /// @brief point the pages of an area at memory, mirroring it until the area is filled
+        /// @param _memory backing memory, nullptr sends the area to the slow path
+        /// @param _memorySize size of the backing memory, a multiple of the page size
+        /// @param _address absolute address of the area
+        /// @param _areaSize size of the area
+        /// @param _writable writes go straight to memory, otherwise they take the slow path
+        void map_memory(u8* _memory, const u32& _memorySize, const u32& _address, const u32& _areaSize, const bool& _writable);
+
     private:
-        std::vector<u8> memoryBIOS;
-        std::vector<u8> boardWRAM;
-        std::vector<u8> chipWRAM;
-        std::vector<u8> ioRegisters;
-        std::vector<u8> memoryROM;
-        std::vector<u8> memorySRAM;
+        // guest memory when fastmem is disabled
+        host_array<u8> memoryArena;
+        bool hugePages;
+        // bound arena and its regions
+        u8* boundArena;
+        u8* memoryBIOS;
+        u8* boardWRAM;
+        u8* chipWRAM;
+        u8* memorySRAM;
+        u8* ioRegisters;
+
+        // write generation of every arena block
+        std::array<u32, MEMORY_DIRTY_BLOCK_COUNT> blockGenerations;
+        u32 memoryGeneration;
+
+        // cycles of every bus_access, indexed by address bits 27-24
+        std::array<std::array<u8, MEMORY_REGION_COUNT>, 4> accessCycles;
+
+        u32 ioReadCount;
+
+        // io register hooks, only allocated once a handler is set
+        std::vector<io_handler> ioHandlers;
+        // IO_HANDLER_* of every register, registers without flags skip the handlers
+        std::array<u8, MEMORY_IO_REGISTER_COUNT> ioHandlerFlags;
+
+        file_image imageBIOS;
+        file_image imageROM;
 
         std::vector<u8> programData;
 
+    private:
+        // backing memory of every page, indexed by address bits 27-14
+        // nullptr sends the access to the slow path (io registers, unmapped and read only memory)
+        host_array<u8*> readPages;
+        host_array<u8*> writePages;
+
+    private:
+        // owns guest memory while enabled
+        fastmem fastmemView;
+        // host address of guest address 0, nullptr while fastmem is disabled
+        u8* fastmemBase;
+
+    private:
+        // one bit for every arena page holding decoded code, writes to other pages never touch the generations
+        host_array<u64> codePages;
+        // write generation of every arena code page
+        host_array<u32> codeGenerations;
+        // generation of the read only images, they only change when replaced
+        u32 imageGeneration;
+
     public:
         bus();
     };
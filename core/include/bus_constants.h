@@ -1,5 +1,6 @@
 #pragma once
 #include "typedefs.h"
+#include <array>
 #include <vector>   
 
 namespace br::gba
@@ -7,7 +8,7 @@ namespace br::gba
     inline constexpr u32 MEMORY_BIOS_SIZE = 0x4000;
     inline constexpr u32 MEMORY_BOARD_WRAM_SIZE = 0x40000;
     inline constexpr u32 MEMORY_CHIP_WRAM_SIZE = 0x8000;
-    inline constexpr u32 MEMORY_IO_REGISTERS_SIZE = 0x3FF;
+    inline constexpr u32 MEMORY_IO_REGISTERS_SIZE = 0x400;
     inline constexpr u32 MEMORY_ROM_SIZE = 0x2000000;
     inline constexpr u32 MEMORY_ROM_TOTAL_SIZE = MEMORY_ROM_SIZE * 3;
     inline constexpr u32 MEMORY_SRAM_SIZE = 0x10000;
@@ -21,6 +22,86 @@ namespace br::gba
     inline constexpr u32 MEMORY_ROM_2_ADDR = 0xC000000;
     inline constexpr u32 MEMORY_SRAM_ADDR = 0xE000000;
 
+    inline constexpr u32 MEMORY_ADDRESS_LIMIT = 0x10000000;
+    inline constexpr u32 MEMORY_REGION_SHIFT = 24;
+    inline constexpr u32 MEMORY_REGION_SIZE = 1 << MEMORY_REGION_SHIFT;
+    inline constexpr u32 MEMORY_REGION_COUNT = MEMORY_ADDRESS_LIMIT >> MEMORY_REGION_SHIFT;
+    inline constexpr u32 MEMORY_PALETTE_ADDR = 0x5000000;
+    inline constexpr u32 MEMORY_VRAM_ADDR = 0x6000000;
+    inline constexpr u32 MEMORY_PAGE_SHIFT = 14;
+    inline constexpr u32 MEMORY_PAGE_SIZE = 1 << MEMORY_PAGE_SHIFT;
+    inline constexpr u32 MEMORY_PAGE_MASK = MEMORY_PAGE_SIZE - 1;
+    inline constexpr u32 MEMORY_PAGE_COUNT = MEMORY_ADDRESS_LIMIT >> MEMORY_PAGE_SHIFT;
+    inline constexpr u32 MEMORY_CODE_PAGE_SHIFT = 8;
+    inline constexpr u32 MEMORY_CODE_PAGE_SIZE = 1 << MEMORY_CODE_PAGE_SHIFT;
+
+    // io registers are dispatched as halfwords
+    inline constexpr u32 MEMORY_IO_REGISTER_COUNT = MEMORY_IO_REGISTERS_SIZE >> 1;
+    inline constexpr u8 IO_HANDLER_READ = 0b01;
+    inline constexpr u8 IO_HANDLER_WRITE = 0b10;
+
+    inline constexpr u32 IO_DISPSTAT_ADDR = 0x4000004;
+    inline constexpr u32 IO_VCOUNT_ADDR = 0x4000006;
+    // TMxCNT_L counter and reload then TMxCNT_H control, for each timer
+    inline constexpr u32 IO_TIMER_ADDR = 0x4000100;
+    inline constexpr u32 IO_TIMER_STRIDE = 4;
+    inline constexpr u32 IO_IE_ADDR = 0x4000200;
+    inline constexpr u32 IO_IF_ADDR = 0x4000202;
+    inline constexpr u32 IO_WAITCNT_ADDR = 0x4000204;
+    inline constexpr u32 IO_IME_ADDR = 0x4000208;
+    // POSTFLG in the low byte, HALTCNT in the high byte
+    inline constexpr u32 IO_POSTFLG_ADDR = 0x4000300;
+    inline constexpr u16 IO_HALTCNT_MASK = 0xFF00;
+    // bit 15 is the game pak type, 0 for gba cartridges
+    inline constexpr u16 IO_WAITCNT_WRITE_MASK = 0x7FFF;
+
+    // rom and sram wait states selected by WAITCNT, sequential ones per rom wait state region
+    inline constexpr std::array<u32, 4> WAITSTATE_NONSEQUENTIAL = { 4, 3, 2, 8 };
+    inline constexpr std::array<std::array<u32, 2>, 3> WAITSTATE_SEQUENTIAL = {{ { 2, 1 }, { 4, 1 }, { 8, 1 } }};
+    // board wram always has 2 wait states
+    inline constexpr u32 WAITSTATE_BOARD_WRAM = 2;
+
+    // fixed layout of the guest memory arena
+    inline constexpr u32 MEMORY_BIOS_OFFSET = 0x0;
+    inline constexpr u32 MEMORY_BOARD_WRAM_OFFSET = MEMORY_BIOS_OFFSET + MEMORY_BIOS_SIZE;
+    inline constexpr u32 MEMORY_CHIP_WRAM_OFFSET = MEMORY_BOARD_WRAM_OFFSET + MEMORY_BOARD_WRAM_SIZE;
+    inline constexpr u32 MEMORY_SRAM_OFFSET = MEMORY_CHIP_WRAM_OFFSET + MEMORY_CHIP_WRAM_SIZE;
+    inline constexpr u32 MEMORY_IO_REGISTERS_OFFSET = MEMORY_SRAM_OFFSET + MEMORY_SRAM_SIZE;
+    // io registers get a whole page so the arena stays page sized
+    inline constexpr u32 MEMORY_ARENA_SIZE = MEMORY_IO_REGISTERS_OFFSET + MEMORY_PAGE_SIZE;
+    // code pages are arena pages, every mirror of an address shares its page
+    inline constexpr u32 MEMORY_CODE_PAGE_COUNT = MEMORY_ARENA_SIZE >> MEMORY_CODE_PAGE_SHIFT;
+
+    // writes stamp the arena in blocks with the current write generation
+    inline constexpr u32 MEMORY_DIRTY_BLOCK_SHIFT = 8;
+    inline constexpr u32 MEMORY_DIRTY_BLOCK_SIZE = 1 << MEMORY_DIRTY_BLOCK_SHIFT;
+    inline constexpr u32 MEMORY_DIRTY_BLOCK_COUNT = MEMORY_ARENA_SIZE >> MEMORY_DIRTY_BLOCK_SHIFT;
+
+    struct memory_mapping
+    {
+        // offset of the memory in the arena
+        u32 offset;
+        u32 size;
+        // area the memory is mirrored across
+        u32 address;
+        u32 areaSize;
+        bool writable;
+    };
+
+    // every area backed by the arena, everything else takes the slow path
+    // rom and a loaded bios are file images mapped on top
+    inline constexpr std::array<memory_mapping, 4> MEMORY_MAPPINGS =
+    {{
+        // bios stays writable through the slow path until an image is loaded, test programs write their boot code into it
+        { MEMORY_BIOS_OFFSET, MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR, MEMORY_BIOS_SIZE, false },
+        { MEMORY_BOARD_WRAM_OFFSET, MEMORY_BOARD_WRAM_SIZE, MEMORY_BOARD_WRAM_ADDR, MEMORY_REGION_SIZE, true },
+        { MEMORY_CHIP_WRAM_OFFSET, MEMORY_CHIP_WRAM_SIZE, MEMORY_CHIP_WRAM_ADDR, MEMORY_REGION_SIZE, true },
+        { MEMORY_SRAM_OFFSET, MEMORY_SRAM_SIZE, MEMORY_SRAM_ADDR, MEMORY_REGION_SIZE * 2, true }
+    }};
+
+    // the fastmem view covers every 32bit address
+    inline constexpr u64 FASTMEM_VIEW_SIZE = 1ull << 32;
+
     template<std::size_t S, u32 A>
     bool test_address_region(const u32& _address, u32& _relativeAddress)
     {
@@ -31,7 +112,7 @@ namespace br::gba
     }
 
     template<std::size_t S, u32 A>
-    bool write_memory(std::vector<u8>& _memArray, const u32& _address, const u8& _data)
+    bool write_memory(u8* _memArray, const u32& _address, const u8& _data)
     {
         bool isInRange = _address >= A && _address < A + S;
         u32 relativeAddress = _address - A;
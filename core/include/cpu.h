@@ -1,23 +1,57 @@
 #pragma once
 #include "typedefs.h"
 #include "cpu_constants.h"
-#include <functional>
+#include "bus_constants.h"
+#include "recompiler.h"
 #include <array>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace br::gba
 {
     class bus;
+    class cpu;
+
+    typedef const u32 (cpu::*cpu_handler)(const u32&);
 
     struct cpu_instruction
     {
         u32 data_mask;
         u32 data_test;
-        std::function<const u32(const u32&)> execute;
+        // returns the handler specialized for the static encoding bits of a decode table index
+        cpu_handler (*specialize)(const u32&);
 
         std::string debug_info;
     };
 
+    struct cpu_decoded_instruction
+    {
+        cpu_handler execute;
+        u32 opcode;
+        // isa entry of the instruction, CODE_CACHE_EMPTY until decoded
+        u32 isaIndex;
+    };
+
+    struct cpu_code_page
+    {
+        // decoded instructions of a page, indexed by halfword offset
+        std::array<cpu_decoded_instruction, MEMORY_CODE_PAGE_SIZE / THUMB_WORD_LENGTH> instructions;
+        // code generation of the bus page the instructions were decoded at
+        u32 generation;
+        // word the bus bumps when the page is written to, compared without calling into the bus
+        const u32* generationSource;
+    };
+
+    struct cpu_idle_loop
+    {
+        // the loop only reads memory and recomputes its registers every iteration
+        bool isIdle;
+        // code generations of the first and last page of the loop when it was analysed
+        u32 startGeneration;
+        u32 endGeneration;
+    };
+
     enum struct cpu_mode : u32
     {
         FIQ = 0,
@@ -29,6 +63,53 @@ namespace br::gba
         USER = 0xFF
     };
 
+    enum struct cpu_backend : u32
+    {
+        // fetch and decode every instruction, used as the reference
+        INTERPRETER,
+        // run instructions from the decoded code cache
+        CACHED,
+        // run hot blocks as translated x86-64 code, everything else from the decoded code cache
+        // falls back to CACHED on hosts without support
+        RECOMPILER
+    };
+
+    enum struct cpu_trace_level : u32
+    {
+        // nothing is recorded, tracing is compiled out of the instruction loop
+        OFF,
+        // opcode and isa entry of every instruction
+        OPCODE,
+        // opcode plus all registers after the instruction
+        FULL
+    };
+
+    struct cpu_trace_record
+    {
+        u32 opcode;
+        // isa entry of the instruction, past the end of the isa when unmatched
+        u32 isaIndex;
+        bool isThumb;
+
+        // only recorded at cpu_trace_level::FULL
+        std::array<u32, REGISTER_LIST_LENGTH> registers;
+        u32 statusRegister;
+        std::array<u32, 5> savedStatusRegisters;
+    };
+
+    // how the flags of the last flag setting instruction are derived from its result and operands
+    enum struct cpu_flag_operation : u32
+    {
+        NONE,
+        LOGICAL,
+        ADD,
+        ADC,
+        SUB,
+        SBC,
+        MULTIPLY,
+        MULTIPLY_LONG
+    };
+
     enum struct cpu_exception : u32
     {
         RESET,
@@ -42,11 +123,31 @@ namespace br::gba
 
     class cpu
     {
+        // translated code runs handlers and updates the run state like the run loops
+        friend class recompiler;
+
     public:
         /// @brief step the cpu
         /// @return cycle count
         const u32 cycle();
 
+        /// @brief run instructions until a cycle budget is spent, the scheduler hands out budgets up to its next event
+        /// @param _cycles cycle budget
+        /// @return cycles taken, the last instruction can overshoot the budget
+        const u32 run(const u32& _cycles);
+
+        /// @brief run instructions until a cycle budget is spent or an instruction count is reached
+        /// @param _cycles cycle budget
+        /// @param _instructions instruction budget, the executed instructions are subtracted
+        /// @return cycles taken, the last instruction can overshoot the budget
+        const u32 run(const u32& _cycles, u64& _instructions);
+
+        /// @brief run one translated block, or the code up to its next jump while it is not translated yet
+        /// debuggers test their breakpoints in between, the other backends run one instruction
+        /// @param _instructions instruction budget, the executed instructions are subtracted
+        /// @return cycles taken
+        const u32 run_block(u64& _instructions);
+
         /// @brief reset the cpu
         void reset();
 
@@ -56,15 +157,58 @@ namespace br::gba
         /// @brief trigger a fast external interrupt
         void fast_interrupt();
 
+        /// @brief set the irq line of the interrupt controller, the irq is taken before the next block of instructions
+        /// a pending irq ends the current run, so enabling irqs in an instruction takes effect right after it
+        /// @param _requested an enabled interrupt is requested and irqs are enabled in IME
+        void set_irq_line(const bool& _requested);
+
+        /// @brief get the cycles spent in the current run, peripherals add them to the scheduler timestamp
+        /// @return cycles before the executing instruction, 0 outside of runs
+        const u32 get_run_cycles();
+
+        /// @brief end the current run after the executing instruction, for events scheduled before the end of its budget
+        void end_run();
+
+        /// @brief stop executing instructions until resume is called, ends the current run
+        void halt();
+
+        /// @brief continue executing instructions after a halt
+        void resume();
+
+        const bool is_halted();
+
+        /// @brief test if the last run ended on a loop that waits for memory to change
+        /// only events change the memory such a loop reads, so time can skip to the next one
+        const bool is_idle();
+
+        /// @brief detect loops waiting for memory to change, runs end on them
+        /// @param _enabled test short backward branches
+        void set_idle_detection(const bool& _enabled);
+
+        const bool get_idle_detection();
+
+        /// @brief select how instructions are executed, can be switched at any time
+        /// @param _backend execution backend
+        void set_backend(const cpu_backend& _backend);
+
+        const cpu_backend get_backend();
+
+        /// @brief set what is recorded for every executed instruction, clears the trace
+        /// @param _level trace level
+        /// @param _bufferLength amount of instructions kept, older ones are overwritten
+        void set_trace_level(const cpu_trace_level& _level, const u32& _bufferLength = TRACE_BUFFER_DEFAULT_LENGTH);
+
+        const cpu_trace_level get_trace_level();
+
     public:
         /// @brief print status information of the cpu, for debug purposes
         /// @return formatted status information
         const std::string debug_print_status();
 
+        /// @brief format the recorded trace, oldest instruction first
+        /// @param _filePath output file
         void debug_save_log(const std::string& _filePath);
 
-        void debug_log_cycle(const u32& _opcode, const cpu_instruction& _instruction);
-
         const std::string debug_print_isa(const bool& _armISA);
 
         const std::string debug_print_status_registers();
@@ -72,19 +216,112 @@ namespace br::gba
         const u32 debug_get_register(const u32& _index);
 
     private:
+        /// @brief record an executed instruction in the trace buffer
+        void debug_log_cycle(const u32& _opcode, const u32& _isaIndex, const bool& _isThumb);
+
+        static const std::string debug_format_status_registers(const u32& _statusRegister, const u32* _savedStatusRegisters);
+
+    private:
+        /// @brief run the loop of the current instruction set until a budget is reached
+        /// @tparam COUNT_INSTRUCTIONS stop at an instruction count as well
+        template <bool COUNT_INSTRUCTIONS>
+        const u32 run_budget(const u32& _cycles, u64& _instructions);
+
+        /// @brief run instructions of one instruction set, a switch to the other one ends the loop
+        /// @tparam THUMB instruction set of the loop
+        /// @tparam TRACE record the instructions in the trace buffer
+        /// @tparam COUNT_INSTRUCTIONS stop at an instruction count as well
+        template <bool THUMB, bool TRACE, bool COUNT_INSTRUCTIONS>
+        void run_loop(const u64& _instructions);
+
+        /// @brief run translated blocks, code that is not hot yet runs from the decoded cache up to its next jump
+        /// @tparam COUNT_INSTRUCTIONS stop at an instruction count as well
+        template <bool COUNT_INSTRUCTIONS>
+        void run_recompiled(const u64& _instructions);
+
+        /// @brief run one translated block, or the cold code up to its next jump
+        /// @tparam COUNT_INSTRUCTIONS stop at an instruction count as well
+        template <bool COUNT_INSTRUCTIONS>
+        void run_recompiled_block(const u64& _instructions);
+
         /// @brief decode 32-bit arm instruction
+        /// @tparam TRACE record the instruction in the trace buffer
         /// @return cycle count
+        template <bool TRACE>
         const u32 decode_arm_instruction();
         /// @brief decode 16-bit thumb instruction
+        /// @tparam TRACE record the instruction in the trace buffer
         /// @return cycle count
+        template <bool TRACE>
         const u32 decode_thumb_instruction();   
 
+        /// @brief decode an arm opcode into its isa entry and specialized handler
+        void decode_arm_opcode(const u32& _opcode, cpu_decoded_instruction& _instruction);
+        /// @brief decode a thumb opcode into its isa entry and specialized handler
+        void decode_thumb_opcode(const u32& _opcode, cpu_decoded_instruction& _instruction);
+
+        /// @brief get the code cache entry for the program counter, decoded pages are created on demand
+        /// @param _isThumb cpu is in thumb mode
+        /// @return cache entry, nullptr when the address cannot be cached
+        cpu_decoded_instruction* get_cached_instruction(const bool& _isThumb);
+
+        /// @brief end the run when a short backward branch was taken twice in a row on an idle loop
+        /// the bus must not have served io reads through read handlers in between, their values change without events
+        /// @param _branchAddress address of the branch
+        /// @param _isThumb cpu is in thumb mode
+        void test_idle_loop(const u32& _branchAddress, const bool& _isThumb);
+
+        /// @brief get the analysis of a loop, analysed again when its code was written to
+        /// @param _start address the loop branches back to
+        /// @param _end address of the branch
+        /// @param _isThumb cpu is in thumb mode
+        /// @return cached analysis
+        cpu_idle_loop* get_idle_loop(const u32& _start, const u32& _end, const bool& _isThumb);
+
+        /// @brief test if a loop only loads, computes and compares, without registers carried between iterations
+        /// @param _start address the loop branches back to
+        /// @param _end address of the branch
+        /// @return true if every iteration computes the same as long as memory does not change
+        const bool analyse_arm_loop(const u32& _start, const u32& _end);
+        const bool analyse_thumb_loop(const u32& _start, const u32& _end);
+
+        /// @brief drop the decoded instructions of a page and mark it as code on the bus again
+        /// @param _page cached page
+        /// @param _address absolute address in the page
+        void reset_code_page(cpu_code_page& _page, const u32& _address);
+
         /// @brief get registers 0 - 15
         /// @param _index register index
         /// @param _forceUser retreive user registers instead of current banked registers
         /// @return register by reference
         u32& get_register(const u32& _index, const bool& _forceUser = false);
 
+        /// @brief set the current program status register, swapping register banks when the mode changes
+        /// @param _status new program status register
+        void set_status_register(const u32& _status);
+
+        /// @brief set the instruction set, a switch ends the run loop of the old one
+        /// @param _isThumb execute thumb instructions
+        void set_thumb_state(const bool& _isThumb);
+
+        /// @brief move the active banked registers of a mode out and the ones of another mode in
+        void swap_register_bank(const cpu_mode& _previousMode, const cpu_mode& _mode);
+
+        /// @brief record the flags of an instruction, they are only computed once something reads them
+        /// @param _operation how the flags are derived
+        /// @param _result result, the high word for multiplies
+        /// @param _operandA first operand, the low word for multiplies
+        /// @param _operandB second operand
+        /// @param _carry shifter carry for logical operations, carry in for ADC/SBC
+        void defer_flags(const cpu_flag_operation& _operation, const u32& _result, const u32& _operandA, const u32& _operandB, const u32& _carry);
+
+        /// @brief compute the deferred flags into the current program status register
+        void materialize_flags();
+
+        /// @brief get the carry flag, computing deferred flags first
+        /// @return 1 when set
+        const u32 get_carry_flag();
+
         /// @brief get saved program status register
         /// @param _isUserMode true when cpu is in user/elevated user mode
         /// @return reference to spsr when not in user mode, otherwise the current psr
@@ -106,23 +343,66 @@ namespace br::gba
 
         void trigger_exception(const cpu_exception& _exception);
 
+        /// @brief recompute if an irq is to be taken, called when the irq line or the I flag changes
+        void update_irq_pending();
+
+        /// @brief get the cycles of a nonsequential data access
+        /// @param _address absolute address
+        /// @param _size access width in bytes
+        /// @return cycle count including wait states
+        const u32 get_data_cycles(const u32& _address, const u32& _size);
+
+        /// @brief get the cycles of a sequential data access following a nonsequential one
+        /// @param _address absolute address
+        /// @return cycle count of a 32 bit access including wait states
+        const u32 get_sequential_data_cycles(const u32& _address);
+
+        /// @brief get the cycles to refill the pipeline at the program counter after a jump
+        /// @return cycle count including wait states
+        const u32 get_refill_cycles();
+
+        /// @brief finish an instruction that wrote the program counter
+        /// ends the run loop on a switch of instruction set and tests short backward branches for idling
+        /// @param _fetchAddress address of the instruction
+        /// @param _isThumb instruction set the instruction was fetched in
+        /// @return refill cycle count
+        const u32 complete_jump(const u32& _fetchAddress, const bool& _isThumb);
+
+        /// @brief get the internal cycles of a multiply, the multiplier array stops early on small multipliers
+        /// @param _multiplier value of the multiplier register
+        /// @param _signed leading ones also stop the multiplier array
+        /// @return 1 - 4 cycles
+        static const u32 get_multiply_cycles(const u32& _multiplier, const bool& _signed);
+
     private:
+        template <u32 DATA_OPCODE, bool IMMEDIATE, bool SHIFT_REGISTER, bool SET_STATUS>
         const u32 arm_dataproc(const u32& _opcode);
+        template <bool LINK>
         const u32 arm_branch(const u32& _opcode);
         const u32 arm_branch_ex(const u32& _opcode);
+        template <bool IMMEDIATE, bool PRE_OFFSET, bool OFFSET_UP, bool BYTE_TRANSFER, bool WRITE_BACK, bool LOAD>
         const u32 arm_trans_single(const u32& _opcode);
+        template <bool PRE_OFFSET, bool OFFSET_UP, bool IMMEDIATE, bool WRITE_BACK, bool LOAD>
         const u32 arm_trans_half(const u32& _opcode);
+        template <bool BYTE_TRANSFER>
         const u32 arm_trans_swap(const u32& _opcode);
+        template <bool PRE_OFFSET, bool OFFSET_UP, bool USER_MODE, bool WRITE_BACK, bool LOAD>
         const u32 arm_trans_block(const u32& _opcode);
+        template <u32 MULTIPLY_TYPE, bool SET_STATUS>
         const u32 arm_multiply(const u32& _opcode);
+        template <bool IMMEDIATE, bool USE_SPSR, bool SET_PSR>
         const u32 arm_psr(const u32& _opcode);
         const u32 arm_soft_interrupt(const u32& _opcode);
 
     private:
         const u32 thumb_shift(const u32& _opcode);
+        template <bool IMMEDIATE, bool SUBTRACT>
         const u32 thumb_data_reg(const u32& _opcode);
+        template <u32 DATA_TYPE>
         const u32 thumb_data_imm(const u32& _opcode);
+        template <u32 ALU_TYPE>
         const u32 thumb_data_alu(const u32& _opcode);
+        template <u32 OPERATION_TYPE>
         const u32 thumb_data_hi(const u32& _opcode);
         const u32 thumb_data_adr(const u32& _opcode);
         const u32 thumb_data_stack(const u32& _opcode);
@@ -132,13 +412,36 @@ namespace br::gba
         const u32 thumb_trans_immediate(const u32& _opcode);
         const u32 thumb_trans_half(const u32& _opcode);
         const u32 thumb_trans_stack(const u32& _opcode);
+        template <bool LOAD>
         const u32 thumb_trans_stackproc(const u32& _opcode);
+        template <bool LOAD>
         const u32 thumb_trans_block(const u32& _opcode);
         const u32 thumb_cond_branch(const u32& _opcode);
         const u32 thumb_branch(const u32& _opcode);
         const u32 thumb_branch_link(const u32& _opcode);
         const u32 thumb_soft_interrupt(const u32& _opcode);
 
+    private:
+        // handler specializations, picked from the static encoding bits of a decode table index
+        static cpu_handler specialize_arm_dataproc(const u32& _index);
+        static cpu_handler specialize_arm_branch(const u32& _index);
+        static cpu_handler specialize_arm_trans_single(const u32& _index);
+        static cpu_handler specialize_arm_trans_half(const u32& _index);
+        static cpu_handler specialize_arm_trans_swap(const u32& _index);
+        static cpu_handler specialize_arm_trans_block(const u32& _index);
+        static cpu_handler specialize_arm_multiply(const u32& _index);
+        static cpu_handler specialize_arm_psr(const u32& _index);
+        static cpu_handler specialize_thumb_data_reg(const u32& _index);
+        static cpu_handler specialize_thumb_data_imm(const u32& _index);
+        static cpu_handler specialize_thumb_data_alu(const u32& _index);
+        static cpu_handler specialize_thumb_data_hi(const u32& _index);
+        static cpu_handler specialize_thumb_trans_stackproc(const u32& _index);
+        static cpu_handler specialize_thumb_trans_block(const u32& _index);
+
+        /// @brief specialization for handlers without any static encoding bits
+        template <cpu_handler H>
+        static cpu_handler specialize_none(const u32& _index);
+
     private:
         /// @brief setup the armISA instruction map
         void create_arm_isa();
@@ -149,8 +452,9 @@ namespace br::gba
         void reset_registers();
 
     private:
-        // general purpose registers 0 - 7
-        u32 thumbRegisters[8];
+        // registers 0 - 15 of the current mode, program counter 15
+        u32 registers[REGISTER_LIST_LENGTH];
+        // banked copies of the inactive modes, swapped with the active registers on a mode change
         // general purpose registers 8 - 12
         // fiq banked registers 8 - 12
         u32 armRegisters[10];
@@ -162,23 +466,72 @@ namespace br::gba
         u32 linkRegisters[6];
         // saved status register for operation modes
         u32 savedStatusRegisters[5];
-        // program counter
-        u32 programCounter;
-        // current program status register
+        // current program status register, NZCV are stale while flagOperation is set
         u32 statusRegister;
 
+        // deferred flags of the last flag setting instruction
+        cpu_flag_operation flagOperation;
+        u32 flagResult;
+        u32 flagOperandA;
+        u32 flagOperandB;
+        u32 flagCarry;
+
     private:
         // arm instruction set array
         std::array<cpu_instruction, ARM_ISA_COUNT> armISA;
+        // first armISA entry to test, indexed by opcode bits 27-20 and 7-4
+        std::array<u8, ARM_DECODE_TABLE_SIZE> armDecodeTable;
+        // specialized handler of the armDecodeTable entry
+        std::array<cpu_handler, ARM_DECODE_TABLE_SIZE> armHandlerTable;
         // thumb instruction set array
         std::array<cpu_instruction, THUMB_ISA_COUNT> thumbISA;
+        // thumbISA entry for every opcode, indexed by opcode bits 15-6
+        std::array<u8, THUMB_DECODE_TABLE_SIZE> thumbDecodeTable;
+        // specialized handler of the thumbDecodeTable entry
+        std::array<cpu_handler, THUMB_DECODE_TABLE_SIZE> thumbHandlerTable;
+
+    private:
+        // how instructions are executed
+        cpu_backend backend;
+        // decoded pages, keyed by page address with the thumb state in bit 0
+        std::unordered_map<u32, cpu_code_page> codeCache;
+        // page the program counter was last fetched from, CODE_CACHE_EMPTY matches no key
+        cpu_code_page* currentCodePage;
+        u32 currentCodePageKey;
+        // translations of hot blocks for cpu_backend::RECOMPILER
+        recompiler blockRecompiler;
+
+        // state of run loops, a switch of instruction set zeroes the budget to leave the loop
+        u32 runBudget;
+        u32 runLimit;
+        u32 runCycles;
+        u64 runInstructions;
+        bool halted;
+
+        bool irqLine;
+        // irq line set and irqs not disabled in the current program status register
+        bool irqPending;
+
+        bool idleDetection;
+        bool idle;
+        // analysed loops, keyed by branch address with the thumb state in bit 0
+        std::unordered_map<u32, cpu_idle_loop> idleLoops;
+        // loop of the short backward branch taken last, with the io read count of the bus at that time
+        cpu_idle_loop* idleLoop;
+        u32 idleLoopKey;
+        u32 idleReadCount;
 
     private:
         // connection to gba bus for memory reading and writing
         bus& addressBus;
 
     private:
-        std::string debugLog;
+        cpu_trace_level traceLevel;
+        // ring buffer of executed instructions
+        std::vector<cpu_trace_record> traceBuffer;
+        // next record to write
+        u32 traceHead;
+        u32 traceCount;
 
     public:
         cpu(bus& _addressBus);
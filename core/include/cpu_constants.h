@@ -4,12 +4,25 @@
 #include <array>
 #include <string>
 #include <algorithm>
+#include <utility>
+#include <type_traits>
 
 namespace br::gba
 {
     inline constexpr u32 ARM_ISA_COUNT = 16;
     inline constexpr u32 THUMB_ISA_COUNT = 19;
 
+    inline constexpr u32 ARM_DECODE_TABLE_SIZE = 4096;
+    inline constexpr u32 ARM_DECODE_INDEX_MASK = 0x0FF000F0;
+    inline constexpr u32 THUMB_DECODE_TABLE_SIZE = 1024;
+    inline constexpr u32 THUMB_DECODE_INDEX_SHIFT = 6;
+    inline constexpr u32 THUMB_DECODE_INDEX_MASK = 0xFFC0;
+
+    inline constexpr u32 TRACE_BUFFER_DEFAULT_LENGTH = 0x10000;
+    inline constexpr u32 CODE_CACHE_EMPTY = 0xFFFFFFFF;
+    // longest loop, including its branch, tested for idling
+    inline constexpr u32 IDLE_LOOP_MAX_INSTRUCTIONS = 8;
+
     inline constexpr u32 ARM_WORD_LENGTH = 4;
     inline constexpr u32 ARM_WORD_BIT_LENGTH = 32;
     inline constexpr u32 THUMB_WORD_LENGTH = 2;
@@ -50,6 +63,8 @@ namespace br::gba
     inline constexpr u32 EXCEPTION_ADDR_FIQ = 0x1C;
 
     inline constexpr u32 ARM_CONDITION_SHIFT = 28;
+    inline constexpr u32 ARM_CONDITION_COUNT = 16;
+    inline constexpr u32 ARM_CONDITION_ALWAYS = 0xE;
     
     inline constexpr u32 ARM_DATAPROC_1_MASK = 0b0000'111'0000'0'0000'0000'00000'00'1'0000;
     inline constexpr u32 ARM_DATAPROC_1_TEST = 0b0000'000'0000'0'0000'0000'00000'00'0'0000;
@@ -229,6 +244,99 @@ namespace br::gba
         return bitString;
     }
 
+    /// @brief get the decode table index of an arm opcode, bits 27-20 and 7-4
+    inline constexpr u32 arm_decode_index(const u32& _opcode)
+    {
+        return ((_opcode >> 16) & 0xFF0) | ((_opcode >> 4) & 0xF);
+    }
+
+    /// @brief get the opcode bits that an arm decode table index represents
+    inline constexpr u32 arm_decode_opcode(const u32& _index)
+    {
+        return ((_index & 0xFF0) << 16) | ((_index & 0xF) << 4);
+    }
+
+    /// @brief get the decode table index of a thumb opcode, bits 15-6
+    inline constexpr u32 thumb_decode_index(const u32& _opcode)
+    {
+        return _opcode >> THUMB_DECODE_INDEX_SHIFT;
+    }
+
+    /// @brief get the opcode bits that a thumb decode table index represents
+    inline constexpr u32 thumb_decode_opcode(const u32& _index)
+    {
+        return _index << THUMB_DECODE_INDEX_SHIFT;
+    }
+
+    template <typename T, typename H, u32 S, u32 N>
+    inline void create_decode_table(const std::array<T, S>& _isaArray, std::array<u8, N>& _decodeTable, std::array<H, N>& _handlerTable, const u32& _indexMask, u32 (*_indexOpcode)(const u32&))
+    {
+        // every table entry holds the first isa entry which could match an opcode with those index bits,
+        // decoding can then start from that entry without testing any of the ones before it
+        for (u32 i = 0; i < N; ++i)
+        {
+            u32 opcode = _indexOpcode(i);
+            u32 isaIndex = 0;
+            for (; isaIndex < S; ++isaIndex)
+            {
+                u32 indexMask = _isaArray[isaIndex].data_mask & _indexMask;
+                if ((indexMask & opcode) == (_isaArray[isaIndex].data_test & _indexMask))
+                    break;
+            }
+
+            _decodeTable[i] = isaIndex;
+            _handlerTable[i] = isaIndex < S ? _isaArray[isaIndex].specialize(i) : nullptr;
+        }
+    }
+
+    /// @brief build the condition lookup, bit n of entry c is set when condition c passes with NZCV flags n
+    inline constexpr std::array<u16, ARM_CONDITION_COUNT> create_condition_table()
+    {
+        std::array<u16, ARM_CONDITION_COUNT> conditionTable{};
+        for (u32 flags = 0; flags < 16; ++flags)
+        {
+            bool n = (flags >> 3) & 0b1;
+            bool z = (flags >> 2) & 0b1;
+            bool c = (flags >> 1) & 0b1;
+            bool v = flags & 0b1;
+
+            std::array<bool, ARM_CONDITION_COUNT> passes =
+            {
+                z,              // EQ
+                !z,             // NE
+                c,              // CS/HS
+                !c,             // CC/LO
+                n,              // MI
+                !n,             // PL
+                v,              // VS
+                !v,             // VC
+                c && !z,        // HI
+                !c || z,        // LS
+                n == v,         // GE
+                n != v,         // LT
+                !z && n == v,   // GT
+                z || n != v,    // LE
+                true,           // AL
+                true            // NV
+            };
+
+            for (u32 condition = 0; condition < ARM_CONDITION_COUNT; ++condition)
+                conditionTable[condition] |= passes[condition] << flags;
+        }
+
+        return conditionTable;
+    }
+
+    inline constexpr std::array<u16, ARM_CONDITION_COUNT> CONDITION_TABLE = create_condition_table();
+
+    /// @brief instantiate a handler for every variant in the sequence
+    /// @param _handler callable taking a std::integral_constant variant and returning its handler
+    template <typename T, typename F, std::size_t... V>
+    inline constexpr std::array<T, sizeof...(V)> create_handler_array(const F& _handler, std::index_sequence<V...>)
+    {
+        return { _handler(std::integral_constant<u32, V>{})... };
+    }
+
     template <typename T, u32 S, u32 SB>
     inline constexpr void sort_isa_array(std::array<T, S>& _isaArray)
     {
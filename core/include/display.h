@@ -0,0 +1,75 @@
+#pragma once
+#include "typedefs.h"
+
+namespace br::gba
+{
+    class bus;
+    class scheduler;
+    class interrupt_controller;
+
+    inline constexpr u32 DISPLAY_HDRAW_CYCLES = 960;
+    inline constexpr u32 DISPLAY_LINE_CYCLES = 1232;
+    inline constexpr u32 DISPLAY_VISIBLE_LINES = 160;
+    inline constexpr u32 DISPLAY_LINE_COUNT = 228;
+    inline constexpr u32 DISPLAY_FRAME_CYCLES = DISPLAY_LINE_CYCLES * DISPLAY_LINE_COUNT;
+
+    // DISPSTAT flags, the vblank flag is cleared on the last line
+    inline constexpr u16 DISPSTAT_VBLANK = 1 << 0;
+    inline constexpr u16 DISPSTAT_HBLANK = 1 << 1;
+    inline constexpr u16 DISPSTAT_VCOUNT = 1 << 2;
+    inline constexpr u16 DISPSTAT_FLAGS_MASK = 0b111;
+    inline constexpr u16 DISPSTAT_VBLANK_IRQ = 1 << 3;
+    inline constexpr u16 DISPSTAT_HBLANK_IRQ = 1 << 4;
+    inline constexpr u16 DISPSTAT_VCOUNT_IRQ = 1 << 5;
+    inline constexpr u32 DISPSTAT_VCOUNT_SHIFT = 8;
+
+    /// @brief display timing, lines and blanking periods are scheduler events
+    /// nothing is drawn, DISPSTAT and VCOUNT follow the timing of the real display and raise its interrupts
+    class display
+    {
+    public:
+        /// @brief start a frame at line 0 at the current timestamp
+        void reset();
+
+        /// @brief continue from the line in VCOUNT after the io registers were replaced
+        /// the position in the line is not kept in them, the line or its hblank restarts at the current timestamp
+        void restore();
+
+        /// @brief get the timestamp the next vblank starts at
+        const u64 get_next_vblank();
+
+        /// @brief get the amount of frames that ended
+        const u64 get_frame_count();
+
+        const u32 get_line();
+
+        /// @brief get the interrupts the display can raise with the enables set in DISPSTAT
+        /// @return IRQ_* bits
+        const u16 get_interrupt_sources();
+
+    private:
+        void start_hblank(const u64& _timestamp);
+        void end_line(const u64& _timestamp);
+
+        /// @brief update DISPSTAT and VCOUNT for the current line
+        void update_line_registers();
+
+        const u16 write_status(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+        const u16 write_line(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+
+    private:
+        bus& addressBus;
+        scheduler& systemScheduler;
+        interrupt_controller& systemInterrupts;
+        u32 hblankEvent;
+        u32 lineEvent;
+
+        u32 line;
+        // timestamp line 0 of the current frame started at
+        u64 frameTimestamp;
+        u64 frameCount;
+
+    public:
+        display(bus& _addressBus, scheduler& _systemScheduler, interrupt_controller& _systemInterrupts);
+    };
+}
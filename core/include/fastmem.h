@@ -0,0 +1,64 @@
+#pragma once
+#include "typedefs.h"
+
+namespace br::gba
+{
+    /// @brief host view of the whole 32bit gba address space, guest address x lives at get_base() + x
+    /// backing memory is a shared memory file, so mirrors are extra mappings of the same memory
+    /// the view is read only, areas without mapped memory read as zero
+    class fastmem
+    {
+    public:
+        /// @brief create the backing memory and reserve the view, only supported on linux
+        /// @param _memorySize size of the backing memory, a multiple of the page size
+        /// @return false if the host does not support it
+        const bool create(const u32& _memorySize);
+
+        /// @brief release the backing memory and the view
+        void destroy();
+
+        /// @brief map backing memory into the view, mirroring it until the area is filled
+        /// @param _offset offset of the memory in the backing memory
+        /// @param _size size of the memory, a multiple of the page size
+        /// @param _address absolute address of the area
+        /// @param _areaSize size of the area
+        /// @return false if the view could not be mapped
+        const bool map_memory(const u32& _offset, const u32& _size, const u32& _address, const u32& _areaSize);
+
+        /// @brief map a read only file into the view, mirroring it until the area is filled
+        /// @param _file file to map
+        /// @param _fileSize size of the file
+        /// @param _size mirror size, a multiple of the page size at least as large as the file
+        /// @param _address absolute address of the area
+        /// @param _areaSize size of the area
+        /// @return false if the view could not be mapped
+        const bool map_file(const int& _file, const u32& _fileSize, const u32& _size, const u32& _address, const u32& _areaSize);
+
+        /// @brief drop what is mapped in an area, it reads as zero afterwards
+        /// @param _address absolute address of the area
+        /// @param _areaSize size of the area
+        /// @return false if the view could not be mapped
+        const bool clear_area(const u32& _address, const u32& _areaSize);
+
+        /// @brief get the backing memory, writes to it show up in the view
+        /// @return nullptr when not created
+        u8* get_memory();
+
+        /// @brief get the host address of guest address 0
+        /// @return nullptr when not created
+        u8* get_base();
+
+    private:
+        int memoryFile;
+        u32 memorySize;
+        u8* memory;
+        u8* view;
+
+    public:
+        fastmem();
+        ~fastmem();
+
+        fastmem(const fastmem&) = delete;
+        fastmem& operator=(const fastmem&) = delete;
+    };
+}
\ No newline at end of file
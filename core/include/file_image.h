@@ -0,0 +1,50 @@
+#pragma once
+#include "typedefs.h"
+#include <string>
+#include <vector>
+
+namespace br::gba
+{
+    /// @brief read only image of a file, mapped straight from the page cache on linux
+    /// the image is padded with zeros to a multiple of the bus page size
+    class file_image
+    {
+    public:
+        /// @brief map a file, a previously opened file is closed first
+        /// @param _filePath file to map
+        /// @param _maxSize largest accepted file size
+        /// @return false if the file could not be read, is empty or is too large
+        const bool open(const std::string& _filePath, const u32& _maxSize);
+
+        void close();
+
+        /// @brief get the image, it must not be written to
+        /// @return nullptr when no file is open
+        u8* get_memory();
+
+        /// @brief get the padded size of the image
+        const u32 get_size();
+
+        const u32 get_file_size();
+
+        /// @brief get the mapped file
+        /// @return -1 when no file is open or the image is a copy
+        const int get_file();
+
+    private:
+        int file;
+        u32 fileSize;
+        u32 size;
+        u8* memory;
+
+        // copy of the file on hosts without mmap
+        std::vector<u8> fileData;
+
+    public:
+        file_image();
+        ~file_image();
+
+        file_image(const file_image&) = delete;
+        file_image& operator=(const file_image&) = delete;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include "typedefs.h"
+#include "scheduler.h"
+#include "bus.h"
+#include "cpu.h"
+#include "interrupt_controller.h"
+#include "display.h"
+#include "timers.h"
+#include <string>
+#include <vector>
+
+namespace br::gba
+{
+    /// @brief the whole system, runs the cpu in budgets up to the next scheduled event
+    class gba
+    {
+    public:
+        const bool load_bios(const std::string& _filePath);
+        const bool load_rom(const std::string& _filePath);
+
+        /// @brief reset the cpu and restart the clock and every peripheral at timestamp 0
+        void reset();
+
+        /// @brief run until a timestamp is reached
+        /// @param _timestamp cycle to stop at
+        /// @return reached timestamp, the last instruction can overshoot it
+        const u64 run_until(const u64& _timestamp);
+
+        /// @brief run until the next vblank starts
+        /// @return reached timestamp
+        const u64 run_frame();
+
+        /// @brief run an amount of instructions, events keep being handled in between
+        /// returns early when the cpu halts and no enabled interrupt source is left to wake it
+        /// @param _count instruction count
+        /// @return reached timestamp
+        const u64 run_instructions(const u64& _count);
+
+        /// @brief copy all guest memory, the io registers included
+        /// @param _state receives the arena, see bus::save_memory_state
+        void save_memory_state(std::vector<u8>& _state);
+
+        /// @brief restore guest memory and rebuild the peripherals from the restored io registers
+        /// the display and the timers restart their current line and periods, the cpu is left as it is
+        /// @param _state state from save_memory_state
+        /// @return false if the state does not match the arena size
+        const bool load_memory_state(const std::vector<u8>& _state);
+
+        /// @brief get the current cycle of the system
+        const u64 get_timestamp();
+
+        /// @brief skip to the next event when the cpu spins in a loop waiting for memory to change
+        /// @param _enabled detect idle loops, HALTCNT always skips
+        void set_idle_skip(const bool& _enabled);
+
+        const bool get_idle_skip();
+
+        bus& get_bus();
+        cpu& get_cpu();
+        scheduler& get_scheduler();
+        interrupt_controller& get_interrupts();
+        display& get_display();
+        timers& get_timers();
+
+    private:
+        /// @brief get the cycles the cpu can run before an event is due
+        /// @param _timestamp cycle to stop at
+        const u32 get_cycle_budget(const u64& _timestamp);
+
+        /// @brief test if a halted cpu can still be woken, some enabled interrupt has a source that raises it
+        /// serial, dma, keypad and game pak interrupts are never raised
+        const bool can_wake();
+
+        /// @brief run the cpu for a budget, time skips to the budget end while it halts or idles
+        /// @param _timestamp cycle to stop at
+        /// @param _instructions instruction budget, the executed instructions are subtracted
+        template <bool COUNT_INSTRUCTIONS>
+        void step(const u64& _timestamp, u64& _instructions);
+
+        const u16 write_power_control(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+
+    private:
+        scheduler systemScheduler;
+        bus systemBus;
+        cpu systemCPU;
+        interrupt_controller systemInterrupts;
+        display systemDisplay;
+        timers systemTimers;
+
+    public:
+        gba();
+
+        gba(const gba&) = delete;
+        gba& operator=(const gba&) = delete;
+    };
+}
@@ -4,4 +4,14 @@
 #include "cpu_constants.h"
 #include "bus_constants.h"
 #include "cpu.h"
-#include "bus.h"
\ No newline at end of file
+#include "fastmem.h"
+#include "file_image.h"
+#include "host_memory.h"
+#include "scheduler.h"
+#include "bus.h"
+#include "interrupt_controller.h"
+#include "display.h"
+#include "timers.h"
+#include "x64_emitter.h"
+#include "recompiler.h"
+#include "gba.h"
\ No newline at end of file
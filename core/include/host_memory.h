@@ -0,0 +1,89 @@
+#pragma once
+#include "typedefs.h"
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace br::gba
+{
+    inline constexpr std::size_t HOST_HUGE_PAGE_SIZE = 0x200000;
+
+    /// @brief allocate zeroed memory, the os only commits pages once they are touched
+    /// @param _size size in bytes
+    /// @param _hugePages align to a huge page and ask the os to back it with huge pages, linux only
+    /// @return nullptr if the allocation failed
+    void* allocate_host_memory(const std::size_t& _size, const bool& _hugePages = false);
+
+    /// @brief free memory from allocate_host_memory
+    /// @param _size size passed to allocate_host_memory
+    /// @param _hugePages flag passed to allocate_host_memory
+    void free_host_memory(void* _memory, const std::size_t& _size, const bool& _hugePages = false);
+
+    /// @brief allocate memory that can be written and executed, for recompiled code
+    /// @param _size size in bytes
+    /// @return nullptr if the allocation failed or the host does not support it
+    void* allocate_executable_memory(const std::size_t& _size);
+
+    /// @brief free memory from allocate_executable_memory
+    /// @param _size size passed to allocate_executable_memory
+    void free_executable_memory(void* _memory, const std::size_t& _size);
+
+    /// @brief fixed size array of zero initialized elements from allocate_host_memory
+    template <typename T>
+    class host_array
+    {
+    public:
+        /// @brief replace the array with a zeroed one, throws std::bad_alloc like std::vector
+        /// @param _count element count
+        /// @param _hugePages back the array with huge pages where supported
+        void allocate(const std::size_t& _count, const bool& _hugePages = false)
+        {
+            release();
+            elements = static_cast<T*>(allocate_host_memory(_count * sizeof(T), _hugePages));
+            if (elements == nullptr)
+                throw std::bad_alloc();
+            count = _count;
+            hugePages = _hugePages;
+        }
+
+        void release()
+        {
+            if (elements != nullptr)
+                free_host_memory(elements, count * sizeof(T), hugePages);
+            elements = nullptr;
+            count = 0;
+            hugePages = false;
+        }
+
+        void swap(host_array& _other)
+        {
+            std::swap(elements, _other.elements);
+            std::swap(count, _other.count);
+            std::swap(hugePages, _other.hugePages);
+        }
+
+        T* data() { return elements; }
+        const std::size_t size() { return count; }
+
+        T& operator[](const std::size_t& _index) { return elements[_index]; }
+
+    private:
+        T* elements;
+        std::size_t count;
+        bool hugePages;
+
+    public:
+        host_array()
+            : elements{ nullptr }, count{ 0 }, hugePages{ false }
+        {
+        }
+
+        ~host_array()
+        {
+            release();
+        }
+
+        host_array(const host_array&) = delete;
+        host_array& operator=(const host_array&) = delete;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include "typedefs.h"
+
+namespace br::gba
+{
+    class bus;
+    class cpu;
+
+    // interrupt sources, bits of IE and IF
+    inline constexpr u16 IRQ_VBLANK = 1 << 0;
+    inline constexpr u16 IRQ_HBLANK = 1 << 1;
+    inline constexpr u16 IRQ_VCOUNT = 1 << 2;
+    inline constexpr u16 IRQ_TIMER_0 = 1 << 3;
+    inline constexpr u16 IRQ_SERIAL = 1 << 7;
+    inline constexpr u16 IRQ_DMA_0 = 1 << 8;
+    inline constexpr u16 IRQ_KEYPAD = 1 << 12;
+    inline constexpr u16 IRQ_GAMEPAK = 1 << 13;
+    inline constexpr u16 IRQ_MASK = 0x3FFF;
+
+    /// @brief IE, IF and IME, drives the irq line of the cpu
+    /// the line is only recomputed when one of the registers changes, the cpu never polls them
+    class interrupt_controller
+    {
+    public:
+        /// @brief clear IE, IF and IME, lowering the irq line
+        void reset();
+
+        /// @brief request interrupts, setting their IF bits
+        /// @param _interrupts IRQ_* bits
+        void request(const u16& _interrupts);
+
+        /// @brief test if an enabled interrupt is requested, regardless of IME, this ends a halt
+        const bool is_requested();
+
+        /// @brief recompute the irq line from the registers, also after io memory was replaced
+        void update();
+
+    private:
+        const u16 write_enable(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+        const u16 write_flags(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+        const u16 write_master_enable(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+
+    private:
+        bus& addressBus;
+        cpu& systemCPU;
+
+    public:
+        interrupt_controller(bus& _addressBus, cpu& _systemCPU);
+    };
+}
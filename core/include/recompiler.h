@@ -0,0 +1,265 @@
+#pragma once
+#include "typedefs.h"
+#include "bus.h"
+#include "x64_emitter.h"
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace br::gba
+{
+    class cpu;
+    struct cpu_instruction;
+    struct cpu_decoded_instruction;
+
+    // blocks are emitted for the system v calling convention
+#if defined(__x86_64__) && !defined(_WIN32)
+    inline constexpr bool RECOMPILER_SUPPORTED = true;
+#else
+    inline constexpr bool RECOMPILER_SUPPORTED = false;
+#endif
+
+    inline constexpr std::size_t RECOMPILER_CODE_SIZE = 0x1000000;
+    // a translation never gets close to this, the buffer is flushed when less is left
+    inline constexpr std::size_t RECOMPILER_BLOCK_MAX_SIZE = 0x10000;
+    inline constexpr u32 RECOMPILER_BLOCK_MAX_INSTRUCTIONS = 32;
+    // blocks are translated once they were entered this often, colder code runs from the decoded cache
+    inline constexpr u32 RECOMPILER_HOT_THRESHOLD = 8;
+    inline constexpr u32 RECOMPILER_LOOKUP_SIZE = 0x1000;
+    inline constexpr u32 RECOMPILER_REGISTER_NONE = 0xFF;
+    inline constexpr u32 RECOMPILER_CARRY_COMPUTED = 2;
+
+    // host registers guest registers are allocated to, callee saved so they survive calls into the core
+    inline constexpr std::array<x64_register, 4> RECOMPILER_GUEST_REGISTERS = { x64_register::RBX, x64_register::R12, x64_register::R13, x64_register::R14 };
+    // the cpu and the access cycle table of the bus stay in these for the whole block
+    inline constexpr x64_register RECOMPILER_CPU_REGISTER = x64_register::RBP;
+    inline constexpr x64_register RECOMPILER_CYCLES_REGISTER = x64_register::R15;
+
+    enum struct recompiler_operation : u32
+    {
+        // call the interpreter handler
+        FALLBACK,
+        // undefined opcode, only the fetch is spent
+        NONE,
+        // data processing without shifts by register, thumb alu formats are translated as their arm equivalent
+        DATA,
+        LOAD,
+        STORE,
+        // branch to a fixed target
+        BRANCH,
+        // set a register to a value known at translation, thumb address generation and the first half of BL
+        SET
+    };
+
+    struct recompiler_operand
+    {
+        bool isImmediate;
+        // immediate value or register index
+        u32 value;
+        // shifter carry of an immediate, the low bit of its unrotated byte
+        u32 carry;
+        // shift of a register, amount 0 is only translated as LSL #0
+        u32 shiftType;
+        u32 shiftAmount;
+    };
+
+    struct recompiler_instruction
+    {
+        recompiler_operation operation;
+        u32 address;
+        // arm condition, thumb instructions other than conditional branches always run
+        u32 condition;
+        // nothing after it runs in sequence
+        bool isBlockEnd;
+        // entry in the fallbacks of the block
+        u32 fallbackIndex;
+
+        // DATA, register operands of LOAD and STORE
+        u32 dataOpcode;
+        bool setFlags;
+        u32 regD;
+        u32 regN;
+        recompiler_operand operand;
+
+        // LOAD and STORE, access width of the bus call and width the data cycles are taken for
+        u32 accessSize;
+        u32 cycleSize;
+        // arm LDRB keeps the low byte of a word read
+        bool isByteOfWord;
+        bool isSigned;
+        bool isPreIndexed;
+        bool isUp;
+        bool writeBack;
+
+        // BRANCH target or SET value
+        u32 value;
+        bool link;
+        u32 linkValue;
+    };
+
+    struct recompiler_exit
+    {
+        std::size_t label;
+        // instructions run when leaving through the exit
+        u32 count;
+        // the program counter is only written back here, fallbacks store it themselves
+        bool storesProgramCounter;
+        u32 programCounter;
+        // an instruction wrote the program counter, the refill is still to be added
+        bool completesJump;
+        u32 fetchAddress;
+    };
+
+    struct recompiler_block
+    {
+        // translated host code, nullptr until the block is hot
+        u8* code;
+        // address with the thumb state in bit 0
+        u32 key;
+        u32 hits;
+        u32 instructionCount;
+        // code generation of the page the block was translated from, compared before every run
+        const u32* generationSource;
+        u32 generation;
+        // instructions the block calls the interpreter handlers of, the host code points into it
+        std::vector<cpu_decoded_instruction> fallbacks;
+    };
+
+    /// @brief translates hot blocks of guest code into x86-64 code
+    /// guest registers live in host registers across a block, loads and stores take inline page table paths
+    /// and everything else calls its interpreter handler, so results and cycles match the interpreter
+    class recompiler
+    {
+    public:
+        /// @brief allocate the code buffer
+        /// @return false if the host cannot run translated code
+        const bool allocate();
+
+        /// @brief get the translated block at an address, blocks are translated once they are hot
+        /// @param _address program counter
+        /// @param _isThumb cpu is in thumb mode
+        /// @return nullptr while the code has to run in the interpreter
+        recompiler_block* get_block(const u32& _address, const bool& _isThumb);
+
+        /// @brief run a block, it adds its cycles and instructions to the run of the cpu
+        /// the block leaves early when the run budget is spent, the program counter changes or it writes its own code
+        void execute(recompiler_block& _block);
+
+        /// @brief drop every translation
+        void flush();
+
+    private:
+        const bool translate(recompiler_block& _block, const u32& _address, const bool& _isThumb);
+        void decode_arm(recompiler_block& _block, recompiler_instruction& _instruction, const u32& _opcode);
+        void decode_thumb(recompiler_block& _block, recompiler_instruction& _instruction, const u32& _opcode);
+
+        /// @brief run an instruction through its interpreter handler
+        /// @param _isBlockEnd the instruction always writes the program counter
+        void set_fallback(recompiler_block& _block, recompiler_instruction& _instruction, const cpu_decoded_instruction& _decoded, const bool& _isBlockEnd);
+
+        /// @brief test which isa entry an instruction was decoded as
+        static const bool is_format(const cpu_instruction& _entry, const u32& _mask, const u32& _test);
+
+        /// @brief hold the most used guest registers of the block in host registers
+        void allocate_registers();
+
+        void emit_prologue();
+        void emit_epilogue();
+        void emit_exits();
+        void emit_instruction(recompiler_block& _block, const recompiler_instruction& _instruction, const u32& _index);
+        void emit_fallback(recompiler_block& _block, const recompiler_instruction& _instruction);
+        void emit_data(const recompiler_instruction& _instruction);
+        void emit_transfer(const recompiler_instruction& _instruction);
+        void emit_branch(const recompiler_instruction& _instruction, const u32& _index);
+
+        /// @brief compute a data processing operand into ecx
+        /// @param _carry compute the shifter carry of a register operand into r8d
+        /// @return constant shifter carry, or RECOMPILER_CARRY_COMPUTED
+        const u32 emit_operand(const recompiler_operand& _operand, const u32& _programCounter, const bool& _carry);
+
+        /// @brief write NZCV from the 64 bit result in rax, logical operations write NZC
+        /// @param _carry shifter carry from emit_operand
+        void emit_flags(const bool& _isLogical, const bool& _isSubtraction, const u32& _carry);
+
+        /// @brief read from the address in esi into eax
+        void emit_read(const u32& _size);
+        /// @brief write edx to the address in esi
+        void emit_write(const u32& _size);
+
+        /// @brief add the cycles of a fetch, wait states are looked up when the code runs
+        void emit_fetch_cycles(const u32& _address);
+        /// @brief add the cycles of a nonsequential data access to the address saved at rsp
+        void emit_data_cycles(const u32& _size, const u32& _internalCycles);
+
+        /// @brief compute deferred flags left by a handler before native code uses them
+        void emit_materialize_flags();
+        /// @brief skip the instruction when its condition fails
+        /// @return label of the skip, 0 for instructions that always run
+        const std::size_t emit_condition(const u32& _condition);
+
+        /// @brief leave the block through an exit stub, stubs are emitted after the last instruction
+        /// @param _label jump to the stub
+        void add_exit(const std::size_t& _label, const u32& _count, const bool& _storesProgramCounter, const u32& _programCounter, const bool& _completesJump = false, const u32& _fetchAddress = 0);
+        /// @brief leave the block when the code of its page was written to
+        void emit_generation_check(const recompiler_block& _block, const u32& _count, const u32& _programCounter);
+
+        void load_register(const x64_register& _destination, const u32& _index, const u32& _programCounter);
+        void store_register(const u32& _index, const x64_register& _source);
+        /// @brief write back the allocated registers the block writes, before core code runs
+        void spill_registers();
+        /// @brief read all allocated registers, handlers may have changed any of them
+        void reload_registers();
+
+        /// @brief address a cpu member relative to the cpu register
+        x64_memory get_cpu_field(const void* _field);
+
+    private:
+        // entered from host code, arguments are passed by value
+        static const u32 execute_handler(cpu* _cpu, const cpu_decoded_instruction* _instruction);
+        static void materialize_flags(cpu* _cpu);
+        static void complete_jump(cpu* _cpu, const u32 _fetchAddress, const u32 _isThumb);
+        static const u32 read_32(bus* _bus, const u32 _address);
+        static const u32 read_16(bus* _bus, const u32 _address);
+        static const u32 read_8(bus* _bus, const u32 _address);
+        static void write_32(bus* _bus, const u32 _address, const u32 _data);
+        static void write_16(bus* _bus, const u32 _address, const u32 _data);
+        static void write_8(bus* _bus, const u32 _address, const u32 _data);
+
+    private:
+        cpu& systemCPU;
+        bus& addressBus;
+
+        // executable buffer blocks are emitted into, flushed whole when full
+        u8* codeMemory;
+        std::size_t codeUsed;
+        x64_emitter emitter;
+        bus_fast_paths fastPaths;
+
+        // translations, keyed by address with the thumb state in bit 0
+        std::unordered_map<u32, recompiler_block> blocks;
+        // recently entered blocks, indexed by halfword address
+        std::array<recompiler_block*, RECOMPILER_LOOKUP_SIZE> lookup;
+
+    private:
+        // state of the translation in progress
+        std::vector<recompiler_instruction> instructions;
+        std::vector<recompiler_exit> exits;
+        std::vector<std::size_t> epilogueJumps;
+        bool isThumb;
+        u32 wordLength;
+        // host register index of every guest register, RECOMPILER_REGISTER_NONE for memory
+        std::array<u8, 16> allocation;
+        // allocated guest registers the block writes
+        u32 writtenRegisters;
+        // no handler ran since the flags were last materialized
+        bool hasFlags;
+
+    public:
+        recompiler(cpu& _systemCPU, bus& _addressBus);
+        ~recompiler();
+
+        recompiler(const recompiler&) = delete;
+        recompiler& operator=(const recompiler&) = delete;
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "typedefs.h"
+#include <functional>
+#include <vector>
+
+namespace br::gba
+{
+    // timestamp of events that are not scheduled
+    inline constexpr u64 SCHEDULER_NEVER = ~0ull;
+
+    // receives the timestamp the event was due at, events handled late can catch up from it
+    typedef std::function<void(const u64& _timestamp)> scheduler_callback;
+
+    struct scheduler_entry
+    {
+        u64 timestamp;
+        // breaks ties between events due at the same time, first scheduled runs first
+        u64 order;
+        u32 event;
+    };
+
+    struct scheduler_slot
+    {
+        scheduler_callback callback;
+        // order of the heap entry that is current, older entries of the event are skipped
+        u64 order;
+        u64 timestamp;
+    };
+
+    /// @brief central clock of the system, subsystems register their next deadline as an event
+    /// the cpu runs in budgets up to the next deadline, so nothing is polled per instruction
+    class scheduler
+    {
+    public:
+        /// @brief register an event
+        /// @param _callback called once the event is due, it may schedule events again
+        /// @return event id
+        const u32 add_event(const scheduler_callback& _callback);
+
+        /// @brief schedule an event at an absolute timestamp, replacing its previous deadline
+        /// @param _event event id
+        /// @param _timestamp cycle the event is due at
+        void schedule(const u32& _event, const u64& _timestamp);
+
+        /// @brief schedule an event relative to the current timestamp, replacing its previous deadline
+        /// @param _event event id
+        /// @param _cycles cycles from now
+        void schedule_in(const u32& _event, const u64& _cycles);
+
+        /// @brief drop the deadline of an event
+        void cancel(const u32& _event);
+
+        const bool is_scheduled(const u32& _event);
+
+        /// @brief get the deadline of an event
+        /// @return SCHEDULER_NEVER when not scheduled
+        const u64 get_event_timestamp(const u32& _event);
+
+        /// @brief get the current cycle of the system
+        const u64 get_timestamp();
+
+        /// @brief get the deadline of the earliest event
+        /// @return SCHEDULER_NEVER when nothing is scheduled
+        const u64 get_next_timestamp();
+
+        /// @brief get the cycles until the earliest event is due
+        /// @return 0 when an event is already due
+        const u64 get_cycles_to_next_event();
+
+        /// @brief move time forward without running events
+        /// @param _cycles elapsed cycles
+        void advance(const u64& _cycles);
+
+        /// @brief run every due event in deadline order, events scheduled by callbacks run too once due
+        void run_events();
+
+        /// @brief set the timestamp to 0 and drop every deadline, events stay registered
+        void reset();
+
+    private:
+        /// @brief drop stale entries from the top of the heap
+        void drop_stale_entries();
+
+        /// @brief rebuild the heap from the current deadlines once stale entries pile up
+        void compact();
+
+        const bool is_current(const scheduler_entry& _entry);
+
+        static const bool compare_entries(const scheduler_entry& _a, const scheduler_entry& _b);
+
+    private:
+        u64 timestamp;
+        // incremented for every heap entry
+        u64 nextOrder;
+        // min heap of deadlines, rescheduled and cancelled events leave stale entries behind
+        std::vector<scheduler_entry> entries;
+        std::vector<scheduler_slot> slots;
+
+    public:
+        scheduler();
+    };
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "typedefs.h"
+#include <array>
+
+namespace br::gba
+{
+    class bus;
+    class scheduler;
+    class cpu;
+    class interrupt_controller;
+
+    inline constexpr u32 TIMER_COUNT = 4;
+    inline constexpr u32 TIMER_PERIOD = 0x10000;
+
+    // TMxCNT_H bits, cascade is ignored by timer 0
+    inline constexpr u16 TIMER_CONTROL_PRESCALER_MASK = 0b11;
+    inline constexpr u16 TIMER_CONTROL_CASCADE = 1 << 2;
+    inline constexpr u16 TIMER_CONTROL_IRQ = 1 << 6;
+    inline constexpr u16 TIMER_CONTROL_ENABLE = 1 << 7;
+    inline constexpr u16 TIMER_CONTROL_MASK = 0b11000111;
+
+    // a timer counts every 1, 64, 256 or 1024 cycles
+    inline constexpr std::array<u32, 4> TIMER_PRESCALER_SHIFTS = { 0, 6, 8, 10 };
+
+    struct timer_state
+    {
+        u16 reload;
+        u16 control;
+        // counter at the start timestamp, a cascading timer counts it directly
+        u16 counter;
+        u64 startTimestamp;
+        u32 overflowEvent;
+    };
+
+    /// @brief the four timers, nothing ticks them
+    /// counters are computed from the start timestamp when read, overflows are scheduler events
+    class timers
+    {
+    public:
+        /// @brief stop every timer and clear its registers
+        void reset();
+
+        /// @brief take the reloads and controls from the io registers after they were replaced
+        /// counters are not kept in them, every timer restarts from its reload at the current timestamp
+        void restore();
+
+        /// @brief get the current counter of a timer
+        /// @param _index timer 0 to 3
+        const u16 get_counter(const u32& _index);
+
+        /// @brief get the interrupts of the enabled timers with their irq bit set
+        /// @return IRQ_* bits
+        const u16 get_interrupt_sources();
+
+    private:
+        /// @brief get the current cycle, including the cycles the cpu ran since the scheduler was advanced
+        const u64 get_timestamp();
+
+        /// @brief test if a timer counts cycles, cascading timers count overflows of the previous timer
+        const bool is_counting(const u32& _index);
+
+        const u16 get_counter(const u32& _index, const u64& _timestamp);
+
+        /// @brief schedule the next overflow of a counting timer from its start timestamp
+        void schedule_overflow(const u32& _index);
+
+        void overflow(const u32& _index, const u64& _timestamp);
+
+        /// @brief raise the interrupt of an overflowed timer and count the overflow in a cascading next timer
+        void signal_overflow(const u32& _index);
+
+        const u16 read_counter(const u32& _index, const u32& _offset);
+        const u16 write_reload(const u32& _index, const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+        const u16 write_control(const u32& _index, const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask);
+
+    private:
+        bus& addressBus;
+        scheduler& systemScheduler;
+        cpu& systemCPU;
+        interrupt_controller& systemInterrupts;
+
+        std::array<timer_state, TIMER_COUNT> timerStates;
+
+    public:
+        timers(bus& _addressBus, scheduler& _systemScheduler, cpu& _systemCPU, interrupt_controller& _systemInterrupts);
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include "typedefs.h"
+#include <cstddef>
+
+namespace br::gba
+{
+    enum struct x64_register : u8
+    {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    // condition codes of jcc and setcc
+    enum struct x64_condition : u8
+    {
+        OVERFLOW, NO_OVERFLOW, BELOW, ABOVE_EQUAL, EQUAL, NOT_EQUAL, BELOW_EQUAL, ABOVE,
+        SIGN, NO_SIGN, PARITY, NO_PARITY, LESS, GREATER_EQUAL, LESS_EQUAL, GREATER
+    };
+
+    // arithmetic group, the value is the /digit of its opcodes
+    enum struct x64_operation : u8
+    {
+        ADD, OR, ADC, SBB, AND, SUB, XOR, CMP
+    };
+
+    // shift group, the value is the /digit of its opcodes
+    enum struct x64_shift : u8
+    {
+        ROL, ROR, RCL, RCR, SHL, SHR, SAL, SAR
+    };
+
+    /// @brief memory operand, base plus displacement with an optional index
+    struct x64_memory
+    {
+        x64_register base;
+        s32 displacement;
+        bool hasIndex;
+        x64_register index;
+        // index is multiplied by 1 << scale
+        u8 scale;
+
+        explicit x64_memory(const x64_register& _base, const s32& _displacement = 0)
+            : base{ _base }, displacement{ _displacement }, hasIndex{ false }, index{ x64_register::RAX }, scale{ 0 }
+        {
+        }
+
+        x64_memory(const x64_register& _base, const x64_register& _index, const u8& _scale, const s32& _displacement = 0)
+            : base{ _base }, displacement{ _displacement }, hasIndex{ true }, index{ _index }, scale{ _scale }
+        {
+        }
+    };
+
+    /// @brief assembler for the subset of x86-64 the recompiler emits
+    /// operations are 32 bit unless _wide is set, writes past the buffer are dropped and flag an overflow
+    class x64_emitter
+    {
+    public:
+        /// @brief start emitting into a buffer
+        /// @param _code executable memory
+        /// @param _capacity size in bytes
+        void reset(u8* _code, const std::size_t& _capacity);
+
+        u8* get_code();
+        const std::size_t get_size();
+
+        /// @brief test if an instruction did not fit the buffer, the code is incomplete then
+        const bool has_overflowed();
+
+    public:
+        void alu(const x64_operation& _operation, const x64_register& _destination, const x64_register& _source, const bool& _wide = false);
+        void alu(const x64_operation& _operation, const x64_register& _destination, const s32& _immediate, const bool& _wide = false);
+        void alu(const x64_operation& _operation, const x64_register& _destination, const x64_memory& _source, const bool& _wide = false);
+        void alu(const x64_operation& _operation, const x64_memory& _destination, const x64_register& _source, const bool& _wide = false);
+        void alu(const x64_operation& _operation, const x64_memory& _destination, const s32& _immediate, const bool& _wide = false);
+
+        void mov(const x64_register& _destination, const x64_register& _source, const bool& _wide = false);
+        void mov(const x64_register& _destination, const u32& _immediate);
+        void mov(const x64_register& _destination, const x64_memory& _source, const bool& _wide = false);
+        void mov(const x64_memory& _destination, const x64_register& _source, const bool& _wide = false);
+        void mov(const x64_memory& _destination, const u32& _immediate);
+        void mov_64(const x64_register& _destination, const u64& _immediate);
+        void mov_16(const x64_memory& _destination, const x64_register& _source);
+        void mov_8(const x64_memory& _destination, const x64_register& _source);
+
+        void movzx_8(const x64_register& _destination, const x64_register& _source);
+        void movzx_8(const x64_register& _destination, const x64_memory& _source);
+        void movzx_16(const x64_register& _destination, const x64_memory& _source);
+        void movsx_8(const x64_register& _destination, const x64_register& _source);
+
+        void test(const x64_register& _destination, const x64_register& _source, const bool& _wide = false);
+        void test(const x64_register& _destination, const u32& _immediate);
+
+        void shift(const x64_shift& _shift, const x64_register& _destination, const u8& _amount, const bool& _wide = false);
+        void bt(const x64_register& _destination, const u8& _bit);
+        void bt(const x64_register& _destination, const x64_register& _bit, const bool& _wide = false);
+        void setcc(const x64_condition& _condition, const x64_register& _destination);
+        void not_(const x64_register& _destination);
+
+        void push(const x64_register& _register);
+        void pop(const x64_register& _register);
+        void ret();
+
+        /// @brief call a function through rax, rax is clobbered
+        void call(const void* _function);
+
+        /// @brief emit a forward jump
+        /// @return label to bind the target to
+        const std::size_t jump();
+        const std::size_t jump(const x64_condition& _condition);
+
+        /// @brief point a forward jump at the current position
+        void bind(const std::size_t& _label);
+
+    private:
+        void emit_8(const u8& _data);
+        void emit_32(const u32& _data);
+
+        /// @brief emit the rex prefix when one of its bits is set
+        /// @param _force emit it anyway, byte operands of registers 4 - 7 need it to address spl - dil
+        void emit_rex(const bool& _wide, const u8& _reg, const u8& _index, const u8& _base, const bool& _force = false);
+
+        /// @brief emit opcode bytes, most significant first
+        void emit_opcode(const u32& _opcode);
+
+        /// @brief emit an instruction with a register operand
+        /// @param _reg register or /digit of the modrm reg field
+        /// @param _byteRegister a byte register is addressed in _reg or _rm
+        void encode(const u32& _opcode, const bool& _wide, const u8& _reg, const x64_register& _rm, const bool& _byteRegister = false);
+
+        /// @brief emit an instruction with a memory operand
+        void encode(const u32& _opcode, const bool& _wide, const u8& _reg, const x64_memory& _rm, const bool& _byteRegister = false);
+
+    private:
+        u8* code;
+        std::size_t capacity;
+        std::size_t size;
+        bool overflowed;
+
+    public:
+        x64_emitter();
+    };
+}
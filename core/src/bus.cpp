@@ -3,119 +3,316 @@
 #include <iomanip>
 #include <fstream>
 #include <iterator>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
 
 namespace br::gba
 {
     const u32 bus::read_32(const u32& _address)
     {
-        u32 lo = read_16(_address);
-        u32 hi = read_16(_address + 2) << 16;
-        return hi | lo;
+        // the host is little endian like the gba, aligned words are loaded as they are
+        u32 data;
+        if (test_fastmem_read(_address, 0b11))
+        {
+            std::memcpy(&data, fastmemBase + _address, sizeof(data));
+            return data;
+        }
+
+        u8* page = get_read_page(_address);
+        if (page == nullptr || (_address & 0b11) != 0)
+            return read_32_slow(_address);
+
+        std::memcpy(&data, page + (_address & MEMORY_PAGE_MASK), sizeof(data));
+        return data;
+    }
+
+    const u32 bus::read_32_slow(const u32& _address)
+    {
+        u32 alignedAddress = _address & ~0b11;
+        u32 relativeAddress = alignedAddress;
+        u32 data;
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(alignedAddress, relativeAddress))
+        {
+            data = read_io(relativeAddress) | (read_io(relativeAddress + 2) << 16);
+        }
+        else
+        {
+            data = read_8(alignedAddress)
+                | (read_8(alignedAddress + 1) << 8)
+                | (read_8(alignedAddress + 2) << 16)
+                | (read_8(alignedAddress + 3) << 24);
+        }
+
+        u32 rotate = (_address & 0b11) * 8;
+        return rotate == 0 ? data : (data >> rotate) | (data << (32 - rotate));
     }
 
     const u16 bus::read_16(const u32& _address)
     {
-        u16 lo = read_8(_address);
-        u16 hi = read_8(_address + 1) << 8;
-        return hi | lo;
+        u16 data;
+        if (test_fastmem_read(_address, 0b1))
+        {
+            std::memcpy(&data, fastmemBase + _address, sizeof(data));
+            return data;
+        }
+
+        u8* page = get_read_page(_address);
+        if (page == nullptr || (_address & 0b1) != 0)
+            return read_16_slow(_address);
+
+        std::memcpy(&data, page + (_address & MEMORY_PAGE_MASK), sizeof(data));
+        return data;
     }
 
-    const u8 bus::read_8(const u32& _address)
+    const u16 bus::read_16_slow(const u32& _address)
     {
-        u32 relativeAdress = _address;
+        u32 alignedAddress = _address & ~0b1;
+        u32 relativeAddress = alignedAddress;
+        u16 data;
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(alignedAddress, relativeAddress))
+            data = read_io(relativeAddress);
+        else
+            data = read_8(alignedAddress) | (read_8(alignedAddress + 1) << 8);
+
+        // a misaligned halfword is rotated within itself
+        return (_address & 0b1) ? (data >> 8) | (data << 8) : data;
+    }
 
-        if (test_address_region<MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR>(_address, relativeAdress))
-            return memoryBIOS[relativeAdress];
+    const u8 bus::read_8(const u32& _address)
+    {
+        if (test_fastmem_read(_address, 0))
+            return fastmemBase[_address];
 
-        if (test_address_region<MEMORY_BOARD_WRAM_SIZE, MEMORY_BOARD_WRAM_ADDR>(_address, relativeAdress))
-            return boardWRAM[relativeAdress];    
-        
-        if (test_address_region<MEMORY_CHIP_WRAM_SIZE, MEMORY_CHIP_WRAM_ADDR>(_address, relativeAdress))
-            return chipWRAM[relativeAdress];
+        u8* page = get_read_page(_address);
+        if (page != nullptr)
+            return page[_address & MEMORY_PAGE_MASK];
 
-        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(_address, relativeAdress))
-            return ioRegisters[relativeAdress];
+        return read_8_slow(_address);
+    }
 
-        if (test_address_region<MEMORY_ROM_TOTAL_SIZE, MEMORY_ROM_0_ADDR>(_address, relativeAdress))
-            return memoryROM[relativeAdress];
+    const u8 bus::read_8_slow(const u32& _address)
+    {
+        u32 relativeAdress = _address;
 
-        if (test_address_region<MEMORY_SRAM_SIZE, MEMORY_SRAM_ADDR>(_address, relativeAdress))
-            return memorySRAM[relativeAdress];        
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(_address, relativeAdress))
+            return read_io(relativeAdress & ~0b1) >> ((relativeAdress & 0b1) * 8);
 
         return 0;    
     }
 
-    void bus::write_32(const u32& _address, const u32& _data)
+    const u16 bus::read_io(const u32& _offset)
     {
-        write_16(_address, _data & 0xFFFF);
-        write_16(_address + 2, _data >> 16);
+        u32 index = _offset >> 1;
+        if (ioHandlerFlags[index] & IO_HANDLER_READ)
+        {
+            ++ioReadCount;
+            return ioHandlers[index].read(_offset);
+        }
+
+        u16 data;
+        std::memcpy(&data, ioRegisters + _offset, sizeof(data));
+        return data;
     }
 
-    void bus::write_16(const u32& _address, const u16& _data)
+    void bus::write_io(const u32& _offset, const u16& _data, const u16& _mask)
     {
-        write_8(_address, _data & 0xFF);
-        write_8(_address + 1, _data >> 8);
+        u16 previous;
+        std::memcpy(&previous, ioRegisters + _offset, sizeof(previous));
+
+        u32 index = _offset >> 1;
+        u16 data = ioHandlerFlags[index] & IO_HANDLER_WRITE
+            ? ioHandlers[index].write(_offset, previous, _data & _mask, _mask)
+            : (previous & ~_mask) | (_data & _mask);
+
+        mark_written(ioRegisters + _offset, sizeof(data));
+        std::memcpy(ioRegisters + _offset, &data, sizeof(data));
     }
 
-    void bus::write_8(const u32& _address, const u8& _data)
+    void bus::write_32(const u32& _address, const u32& _data)
     {
-        if (write_memory<MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR>(memoryBIOS, _address, _data))
+        u8* page = get_write_page(_address);
+        if (page == nullptr || (_address & 0b11) != 0)
+        {
+            write_32_slow(_address, _data);
             return;
+        }
 
-        if (write_memory<MEMORY_BOARD_WRAM_SIZE, MEMORY_BOARD_WRAM_ADDR>(boardWRAM, _address, _data))
-            return;
+        u8* memory = page + (_address & MEMORY_PAGE_MASK);
+        test_code_write(memory);
+        mark_written(memory, sizeof(_data));
+        std::memcpy(memory, &_data, sizeof(_data));
+    }
 
-        if (write_memory<MEMORY_CHIP_WRAM_SIZE, MEMORY_CHIP_WRAM_ADDR>(chipWRAM, _address, _data))
+    void bus::write_32_slow(const u32& _address, const u32& _data)
+    {
+        u32 alignedAddress = _address & ~0b11;
+        u32 relativeAddress = alignedAddress;
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(alignedAddress, relativeAddress))
+        {
+            write_io(relativeAddress, _data & 0xFFFF, 0xFFFF);
+            write_io(relativeAddress + 2, _data >> 16, 0xFFFF);
             return;
+        }
 
-        if (write_memory<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(ioRegisters, _address, _data))
-            return;
+        write_8(alignedAddress, _data & 0xFF);
+        write_8(alignedAddress + 1, (_data >> 8) & 0xFF);
+        write_8(alignedAddress + 2, (_data >> 16) & 0xFF);
+        write_8(alignedAddress + 3, _data >> 24);
+    }
 
-        if (write_memory<MEMORY_ROM_TOTAL_SIZE, MEMORY_ROM_0_ADDR>(memoryROM, _address, _data))
+    void bus::write_16(const u32& _address, const u16& _data)
+    {
+        u8* page = get_write_page(_address);
+        if (page == nullptr || (_address & 0b1) != 0)
+        {
+            write_16_slow(_address, _data);
             return;
+        }
+
+        u8* memory = page + (_address & MEMORY_PAGE_MASK);
+        test_code_write(memory);
+        mark_written(memory, sizeof(_data));
+        std::memcpy(memory, &_data, sizeof(_data));
+    }
 
-        if (write_memory<MEMORY_SRAM_SIZE, MEMORY_SRAM_ADDR>(memorySRAM, _address, _data))
+    void bus::write_16_slow(const u32& _address, const u16& _data)
+    {
+        u32 alignedAddress = _address & ~0b1;
+        u32 relativeAddress = alignedAddress;
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(alignedAddress, relativeAddress))
+        {
+            write_io(relativeAddress, _data, 0xFFFF);
             return;
+        }
+
+        write_8(alignedAddress, _data & 0xFF);
+        write_8(alignedAddress + 1, _data >> 8);
     }
 
-    const bool bus::load_bios(const std::string& _filePath)
+    void bus::write_8(const u32& _address, const u8& _data)
     {
-        std::ifstream file(_filePath, std::ios::binary | std::ios::ate);
-        file.unsetf(std::ios::skipws);
+        u8* page = get_write_page(_address);
+        if (page != nullptr)
+        {
+            u8* memory = page + (_address & MEMORY_PAGE_MASK);
+            test_code_write(memory);
+            mark_written(memory, sizeof(_data));
+            *memory = _data;
+            return;
+        }
 
-        if (!file.good())
-            return false;
+        write_8_slow(_address, _data);
+    }
 
-        std::streampos fileSize = file.tellg();
-        file.seekg(0, std::ios::beg);
+    void bus::write_8_slow(const u32& _address, const u8& _data)
+    {
+        // bios stays writable until an image is loaded, test programs write their boot code into it
+        // rom images are read only
+        if (imageBIOS.get_memory() == nullptr && write_memory<MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR>(memoryBIOS, _address, _data))
+        {
+            test_code_write(memoryBIOS + (_address - MEMORY_BIOS_ADDR));
+            mark_written(memoryBIOS + (_address - MEMORY_BIOS_ADDR), sizeof(_data));
+            return;
+        }
+
+        u32 relativeAddress = _address;
+        if (test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(_address, relativeAddress))
+        {
+            u32 shift = (relativeAddress & 0b1) * 8;
+            write_io(relativeAddress & ~0b1, _data << shift, 0xFF << shift);
+        }
+    }
 
-        if (fileSize > MEMORY_BIOS_SIZE)
-            return false;
+    void bus::read_block_32(const u32& _address, u32* _data, const u32& _count)
+    {
+        // the host is little endian like the gba, words are copied as they are
+        transfer_block<u32, false>(_address & ~0b11, reinterpret_cast<u8*>(_data), _count * sizeof(u32));
+    }
 
-        file.read(reinterpret_cast<char*>(memoryBIOS.data()), fileSize);
-        file.close();
+    void bus::write_block_32(const u32& _address, const u32* _data, const u32& _count)
+    {
+        transfer_block<u32, true>(_address & ~0b11, reinterpret_cast<u8*>(const_cast<u32*>(_data)), _count * sizeof(u32));
+    }
 
-        return true;
+    void bus::read_block(const u32& _address, u8* _data, const u32& _size)
+    {
+        transfer_block<u8, false>(_address, _data, _size);
     }
 
-    const bool bus::load_rom(const std::string& _filePath)
+    void bus::write_block(const u32& _address, const u8* _data, const u32& _size)
     {
-        std::ifstream file(_filePath, std::ios::binary | std::ios::ate);
-        file.unsetf(std::ios::skipws);
+        transfer_block<u8, true>(_address, const_cast<u8*>(_data), _size);
+    }
 
-        if (!file.good())
-            return false;
+    template <typename T, bool WRITE>
+    void bus::transfer_block(const u32& _address, u8* _data, const u32& _size)
+    {
+        u32 address = _address;
+        u32 remaining = _size;
+        while (remaining > 0)
+        {
+            u32 pageOffset = address & MEMORY_PAGE_MASK;
+            u32 chunk = std::min(remaining, MEMORY_PAGE_SIZE - pageOffset);
+
+            u8* page = WRITE ? get_write_page(address) : get_read_page(address);
+            if (page != nullptr)
+            {
+                if constexpr (WRITE)
+                {
+                    test_code_write_range(page + pageOffset, chunk);
+                    mark_written(page + pageOffset, chunk);
+                    std::memcpy(page + pageOffset, _data, chunk);
+                }
+                else
+                {
+                    std::memcpy(_data, page + pageOffset, chunk);
+                }
+            }
+            else
+            {
+                for (u32 i = 0; i < chunk; i += sizeof(T))
+                {
+                    T data;
+                    if constexpr (WRITE)
+                    {
+                        std::memcpy(&data, _data + i, sizeof(T));
+                        if constexpr (sizeof(T) == sizeof(u32))
+                            write_32(address + i, data);
+                        else
+                            write_8(address + i, data);
+                    }
+                    else
+                    {
+                        if constexpr (sizeof(T) == sizeof(u32))
+                            data = read_32(address + i);
+                        else
+                            data = read_8(address + i);
+                        std::memcpy(_data + i, &data, sizeof(T));
+                    }
+                }
+            }
+
+            address += chunk;
+            _data += chunk;
+            remaining -= chunk;
+        }
+    }
 
-        std::streampos fileSize = file.tellg();
-        file.seekg(0, std::ios::beg);
+    const bool bus::load_bios(const std::string& _filePath)
+    {
+        bool isLoaded = imageBIOS.open(_filePath, MEMORY_BIOS_SIZE);
+        map_images();
 
-        if (fileSize > MEMORY_ROM_TOTAL_SIZE)
-            return false;
+        return isLoaded;
+    }
 
-        file.read(reinterpret_cast<char*>(memoryROM.data()), fileSize);
-        file.close();
+    const bool bus::load_rom(const std::string& _filePath)
+    {
+        bool isLoaded = imageROM.open(_filePath, MEMORY_ROM_SIZE);
+        map_images();
 
-        return true;
+        return isLoaded;
     }
 
     const bool bus::debug_load_program(const std::string& _filePath)
@@ -145,13 +342,409 @@ namespace br::gba
         return statusInfo.str();
     }
 
+    const bool bus::add_code_page(const u32& _address)
+    {
+        // reads from io registers are not free of side effects
+        bool isCacheable = _address < MEMORY_ADDRESS_LIMIT && (_address >> 24) != (MEMORY_IO_REGISTERS_ADDR >> 24);
+        if (!isCacheable)
+            return false;
+
+        // images are read only, nothing to mark
+        u32 codePage = 0;
+        if (get_code_page(_address, codePage))
+            codePages[codePage >> 6] |= 1ull << (codePage & 63);
+
+        return true;
+    }
+
+    const u32 bus::get_code_generation(const u32& _address)
+    {
+        u32 codePage = 0;
+        return get_code_page(_address, codePage) ? codeGenerations[codePage] : imageGeneration;
+    }
+
+    const u32* bus::get_code_generation_source(const u32& _address)
+    {
+        u32 codePage = 0;
+        return get_code_page(_address, codePage) ? &codeGenerations[codePage] : &imageGeneration;
+    }
+
+    const u32 bus::get_access_cycles(const u32& _address, const bus_access& _access)
+    {
+        // nothing is mapped past the regions, the access still takes a cycle
+        if (_address >= MEMORY_ADDRESS_LIMIT)
+            return 1;
+
+        return accessCycles[(u32)_access][_address >> MEMORY_REGION_SHIFT];
+    }
+
+    const u16 bus::write_wait_control(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        u16 waitControl = ((_previous & ~_mask) | _data) & IO_WAITCNT_WRITE_MASK;
+        update_wait_states(waitControl);
+        return waitControl;
+    }
+
+    void bus::update_wait_states(const u16& _waitControl)
+    {
+        // bios, chip wram, io registers and oam are on a 32 bit bus without wait states
+        for (std::array<u8, MEMORY_REGION_COUNT>& cycles : accessCycles)
+            cycles.fill(1);
+
+        set_region_cycles(MEMORY_BOARD_WRAM_ADDR, 1 + WAITSTATE_BOARD_WRAM, 1 + WAITSTATE_BOARD_WRAM);
+        set_region_cycles(MEMORY_PALETTE_ADDR, 1, 1);
+        set_region_cycles(MEMORY_VRAM_ADDR, 1, 1);
+
+        // every rom wait state region is two regions large, bits 2-4, 5-7 and 8-10
+        for (u32 waitState = 0; waitState < WAITSTATE_SEQUENTIAL.size(); ++waitState)
+        {
+            u32 shift = 2 + waitState * 3;
+            u32 nonsequential = 1 + WAITSTATE_NONSEQUENTIAL[(_waitControl >> shift) & 0b11];
+            u32 sequential = 1 + WAITSTATE_SEQUENTIAL[waitState][(_waitControl >> (shift + 2)) & 0b1];
+
+            u32 address = MEMORY_ROM_0_ADDR + waitState * MEMORY_REGION_SIZE * 2;
+            set_region_cycles(address, nonsequential, sequential);
+            set_region_cycles(address + MEMORY_REGION_SIZE, nonsequential, sequential);
+        }
+
+        // sram has an 8 bit bus, wider accesses only transfer a byte
+        u32 sramCycles = 1 + WAITSTATE_NONSEQUENTIAL[_waitControl & 0b11];
+        for (u32 region = MEMORY_SRAM_ADDR >> MEMORY_REGION_SHIFT; region < MEMORY_REGION_COUNT; ++region)
+        {
+            for (std::array<u8, MEMORY_REGION_COUNT>& cycles : accessCycles)
+                cycles[region] = sramCycles;
+        }
+    }
+
+    void bus::set_region_cycles(const u32& _address, const u32& _nonsequential, const u32& _sequential)
+    {
+        u32 region = _address >> MEMORY_REGION_SHIFT;
+        accessCycles[(u32)bus_access::NONSEQUENTIAL_16][region] = _nonsequential;
+        accessCycles[(u32)bus_access::SEQUENTIAL_16][region] = _sequential;
+        accessCycles[(u32)bus_access::NONSEQUENTIAL_32][region] = _nonsequential + _sequential;
+        accessCycles[(u32)bus_access::SEQUENTIAL_32][region] = _sequential * 2;
+    }
+
+    const bool bus::set_io_handler(const u32& _address, const io_read_callback& _read, const io_write_callback& _write)
+    {
+        u32 relativeAddress = _address & ~0b1;
+        if (!test_address_region<MEMORY_IO_REGISTERS_SIZE, MEMORY_IO_REGISTERS_ADDR>(_address & ~0b1, relativeAddress))
+            return false;
+
+        if (ioHandlers.empty())
+            ioHandlers.resize(MEMORY_IO_REGISTER_COUNT);
+
+        u32 index = relativeAddress >> 1;
+        ioHandlers[index] = { _read, _write };
+        ioHandlerFlags[index] = (_read ? IO_HANDLER_READ : 0) | (_write ? IO_HANDLER_WRITE : 0);
+
+        return true;
+    }
+
+    const u16 bus::get_io_register(const u32& _address)
+    {
+        u16 data;
+        std::memcpy(&data, ioRegisters + (_address & (MEMORY_IO_REGISTERS_SIZE - 1) & ~0b1), sizeof(data));
+        return data;
+    }
+
+    const u32 bus::get_io_read_count()
+    {
+        return ioReadCount;
+    }
+
+    void bus::set_io_register(const u32& _address, const u16& _data)
+    {
+        u8* memory = ioRegisters + (_address & (MEMORY_IO_REGISTERS_SIZE - 1) & ~0b1);
+        mark_written(memory, sizeof(_data));
+        std::memcpy(memory, &_data, sizeof(_data));
+    }
+
+    const bool bus::set_fastmem(const bool& _enabled)
+    {
+        if (_enabled == (fastmemBase != nullptr))
+            return true;
+
+        if (!_enabled)
+        {
+            memoryArena.allocate(MEMORY_ARENA_SIZE, hugePages);
+            std::memcpy(memoryArena.data(), fastmemView.get_memory(), MEMORY_ARENA_SIZE);
+
+            fastmemBase = nullptr;
+            bind_memory(memoryArena.data());
+            fastmemView.destroy();
+            return true;
+        }
+
+        if (!fastmemView.create(MEMORY_ARENA_SIZE))
+            return false;
+
+        for (const memory_mapping& mapping : MEMORY_MAPPINGS)
+        {
+            if (!fastmemView.map_memory(mapping.offset, mapping.size, mapping.address, mapping.areaSize))
+            {
+                fastmemView.destroy();
+                return false;
+            }
+        }
+
+        std::memcpy(fastmemView.get_memory(), memoryArena.data(), MEMORY_ARENA_SIZE);
+        // release the plain allocation
+        memoryArena.release();
+
+        fastmemBase = fastmemView.get_base();
+        bind_memory(fastmemView.get_memory());
+
+        // binding falls back to the page table when the images cannot be mapped
+        return get_fastmem();
+    }
+
+    const bool bus::get_fastmem()
+    {
+        return fastmemBase != nullptr;
+    }
+
+    void bus::set_huge_pages(const bool& _enabled)
+    {
+        if (_enabled == hugePages)
+            return;
+
+        hugePages = _enabled;
+        if (fastmemBase != nullptr)
+            return;
+
+        host_array<u8> arena;
+        arena.allocate(MEMORY_ARENA_SIZE, hugePages);
+        std::memcpy(arena.data(), memoryArena.data(), MEMORY_ARENA_SIZE);
+
+        memoryArena.swap(arena);
+        bind_memory(memoryArena.data());
+    }
+
+    const bool bus::get_huge_pages()
+    {
+        return hugePages;
+    }
+
+    void bus::save_memory_state(std::vector<u8>& _state)
+    {
+        _state.resize(MEMORY_ARENA_SIZE);
+        std::memcpy(_state.data(), boundArena, MEMORY_ARENA_SIZE);
+    }
+
+    const bool bus::load_memory_state(const std::vector<u8>& _state)
+    {
+        if (_state.size() != MEMORY_ARENA_SIZE)
+            return false;
+
+        std::memcpy(boundArena, _state.data(), MEMORY_ARENA_SIZE);
+        mark_written(boundArena, MEMORY_ARENA_SIZE);
+        invalidate_code_pages();
+        update_wait_states(read_io(IO_WAITCNT_ADDR - MEMORY_IO_REGISTERS_ADDR));
+
+        return true;
+    }
+
+    const bool bus::update_memory_state(std::vector<u8>& _state, const u32& _generation)
+    {
+        if (_state.size() != MEMORY_ARENA_SIZE)
+            return false;
+
+        for (u32 block = 0; block < MEMORY_DIRTY_BLOCK_COUNT; ++block)
+        {
+            if (blockGenerations[block] < _generation)
+                continue;
+
+            u32 offset = block << MEMORY_DIRTY_BLOCK_SHIFT;
+            std::memcpy(_state.data() + offset, boundArena + offset, MEMORY_DIRTY_BLOCK_SIZE);
+        }
+
+        return true;
+    }
+
+    const u32 bus::checkpoint_memory()
+    {
+        return ++memoryGeneration;
+    }
+
+    void bus::get_dirty_blocks(const u32& _generation, std::vector<u64>& _bitmap)
+    {
+        _bitmap.assign((MEMORY_DIRTY_BLOCK_COUNT + 63) / 64, 0);
+        for (u32 block = 0; block < MEMORY_DIRTY_BLOCK_COUNT; ++block)
+            _bitmap[block >> 6] |= u64(blockGenerations[block] >= _generation && blockGenerations[block] != 0) << (block & 63);
+    }
+
+    const bool bus::test_dirty(const u32& _offset, const u32& _size, const u32& _generation)
+    {
+        u32 lastBlock = (_offset + _size - 1) >> MEMORY_DIRTY_BLOCK_SHIFT;
+        for (u32 block = _offset >> MEMORY_DIRTY_BLOCK_SHIFT; block <= lastBlock; ++block)
+        {
+            if (blockGenerations[block] >= _generation && blockGenerations[block] != 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    const bool bus::test_fastmem_read(const u32& _address, const u32& _alignMask)
+    {
+        // the view covers every address, only io registers need their handlers
+        return fastmemBase != nullptr && (_address & _alignMask) == 0
+            && (_address >> 24) != (MEMORY_IO_REGISTERS_ADDR >> 24);
+    }
+
+    u8* bus::get_read_page(const u32& _address)
+    {
+        return _address < MEMORY_ADDRESS_LIMIT ? readPages[_address >> MEMORY_PAGE_SHIFT] : nullptr;
+    }
+
+    u8* bus::get_write_page(const u32& _address)
+    {
+        return _address < MEMORY_ADDRESS_LIMIT ? writePages[_address >> MEMORY_PAGE_SHIFT] : nullptr;
+    }
+
+    const bool bus::get_code_page(const u32& _address, u32& _codePage)
+    {
+        u8* page = get_read_page(_address);
+        if (page == nullptr)
+            return false;
+
+        // image pages live outside the arena, their offsets wrap past its size
+        std::uintptr_t offset = reinterpret_cast<std::uintptr_t>(page + (_address & MEMORY_PAGE_MASK)) - reinterpret_cast<std::uintptr_t>(boundArena);
+        if (offset >= MEMORY_ARENA_SIZE)
+            return false;
+
+        _codePage = (u32)(offset >> MEMORY_CODE_PAGE_SHIFT);
+        return true;
+    }
+
+    void bus::test_code_write(const u8* _memory)
+    {
+        u32 codePage = (u32)(_memory - boundArena) >> MEMORY_CODE_PAGE_SHIFT;
+        if ((codePages[codePage >> 6] >> (codePage & 63)) & 0b1)
+        {
+            codePages[codePage >> 6] &= ~(1ull << (codePage & 63));
+            ++codeGenerations[codePage];
+        }
+    }
+
+    void bus::mark_written(const u8* _memory, const u32& _size)
+    {
+        u32 offset = _memory - boundArena;
+        u32 lastBlock = (offset + _size - 1) >> MEMORY_DIRTY_BLOCK_SHIFT;
+        for (u32 block = offset >> MEMORY_DIRTY_BLOCK_SHIFT; block <= lastBlock; ++block)
+            blockGenerations[block] = memoryGeneration;
+    }
+
+    void bus::test_code_write_range(const u8* _memory, const u32& _size)
+    {
+        u32 offset = _memory - boundArena;
+        u32 lastCodePage = (offset + _size - 1) >> MEMORY_CODE_PAGE_SHIFT;
+        for (u32 codePage = offset >> MEMORY_CODE_PAGE_SHIFT; codePage <= lastCodePage; ++codePage)
+            test_code_write(boundArena + (codePage << MEMORY_CODE_PAGE_SHIFT));
+    }
+
+    void bus::invalidate_code_pages()
+    {
+        ++imageGeneration;
+
+        for (u32 word = 0; word < codePages.size(); ++word)
+        {
+            u64 bits = codePages[word];
+            if (bits == 0)
+                continue;
+
+            codePages[word] = 0;
+            for (u32 bit = 0; bit < 64; ++bit)
+            {
+                if ((bits >> bit) & 0b1)
+                    ++codeGenerations[(word << 6) | bit];
+            }
+        }
+    }
+
+    void bus::bind_memory(u8* _arena)
+    {
+        boundArena = _arena;
+        memoryBIOS = _arena + MEMORY_BIOS_OFFSET;
+        boardWRAM = _arena + MEMORY_BOARD_WRAM_OFFSET;
+        chipWRAM = _arena + MEMORY_CHIP_WRAM_OFFSET;
+        memorySRAM = _arena + MEMORY_SRAM_OFFSET;
+        ioRegisters = _arena + MEMORY_IO_REGISTERS_OFFSET;
+
+        for (const memory_mapping& mapping : MEMORY_MAPPINGS)
+            map_memory(_arena + mapping.offset, mapping.size, mapping.address, mapping.areaSize, mapping.writable);
+
+        map_images();
+    }
+
+    void bus::map_images()
+    {
+        if (imageBIOS.get_memory() != nullptr)
+            map_memory(imageBIOS.get_memory(), imageBIOS.get_size(), MEMORY_BIOS_ADDR, MEMORY_BIOS_SIZE, false);
+        else
+            map_memory(memoryBIOS, MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR, MEMORY_BIOS_SIZE, false);
+
+        // the image is mirrored from its padded size, so the rom regions need no memory of their own
+        map_memory(imageROM.get_memory(), imageROM.get_size(), MEMORY_ROM_0_ADDR, MEMORY_ROM_TOTAL_SIZE, false);
+
+        if (fastmemBase != nullptr && !map_fastmem_images())
+            set_fastmem(false);
+
+        // code decoded from a replaced image must not run again
+        invalidate_code_pages();
+    }
+
+    const bool bus::map_fastmem_images()
+    {
+        bool isMapped = imageBIOS.get_memory() != nullptr
+            ? fastmemView.map_file(imageBIOS.get_file(), imageBIOS.get_file_size(), imageBIOS.get_size(), MEMORY_BIOS_ADDR, MEMORY_BIOS_SIZE)
+            : fastmemView.map_memory(MEMORY_BIOS_OFFSET, MEMORY_BIOS_SIZE, MEMORY_BIOS_ADDR, MEMORY_BIOS_SIZE);
+
+        if (imageROM.get_memory() != nullptr)
+            return isMapped && fastmemView.map_file(imageROM.get_file(), imageROM.get_file_size(), imageROM.get_size(), MEMORY_ROM_0_ADDR, MEMORY_ROM_TOTAL_SIZE);
+
+        return isMapped && fastmemView.clear_area(MEMORY_ROM_0_ADDR, MEMORY_ROM_TOTAL_SIZE);
+    }
+
+    void bus::map_memory(u8* _memory, const u32& _memorySize, const u32& _address, const u32& _areaSize, const bool& _writable)
+    {
+        for (u32 offset = 0; offset < _areaSize; offset += MEMORY_PAGE_SIZE)
+        {
+            u32 page = (_address + offset) >> MEMORY_PAGE_SHIFT;
+            u8* memory = _memory != nullptr ? _memory + (offset % _memorySize) : nullptr;
+            // leave untouched table pages uncommitted
+            if (memory == nullptr && readPages[page] == nullptr && writePages[page] == nullptr)
+                continue;
+
+            readPages[page] = memory;
+            writePages[page] = _writable ? memory : nullptr;
+        }
+    }
+
+    const bus_fast_paths bus::get_fast_paths()
+    {
+        return { readPages.data(), writePages.data(), &boundArena, codePages.data(), blockGenerations.data(), &memoryGeneration, &accessCycles[0][0] };
+    }
+
     bus::bus()
+        : hugePages{ false }, memoryGeneration{ 1 }, ioReadCount{ 0 }, fastmemBase{ nullptr }, imageGeneration{ 0 }
     {
-        memoryBIOS.resize(MEMORY_BIOS_SIZE, 0);
-        boardWRAM.resize(MEMORY_BOARD_WRAM_SIZE, 0);
-        chipWRAM.resize(MEMORY_CHIP_WRAM_SIZE, 0);
-        ioRegisters.resize(MEMORY_IO_REGISTERS_SIZE, 0);
-        memoryROM.resize(MEMORY_ROM_TOTAL_SIZE, 0);
-        memorySRAM.resize(MEMORY_SRAM_SIZE, 0);
+        // 0 marks blocks that were never written
+        blockGenerations.fill(0);
+        ioHandlerFlags.fill(0);
+
+        // demand zeroed, only the pages the guest touches are committed
+        memoryArena.allocate(MEMORY_ARENA_SIZE);
+
+        readPages.allocate(MEMORY_PAGE_COUNT);
+        writePages.allocate(MEMORY_PAGE_COUNT);
+        bind_memory(memoryArena.data());
+
+        codePages.allocate((MEMORY_CODE_PAGE_COUNT + 63) / 64);
+        codeGenerations.allocate(MEMORY_CODE_PAGE_COUNT);
+
+        update_wait_states(0);
+        set_io_handler(IO_WAITCNT_ADDR, nullptr, std::bind(&bus::write_wait_control, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
     }
 }
\ No newline at end of file
@@ -8,10 +8,48 @@ namespace br::gba
 {
     const u32 cpu::cycle()
     {
-        if (get_bit_bool(statusRegister, STATUS_REGISTER_T))
-            return decode_thumb_instruction();
+        bool isThumb = get_bit_bool(statusRegister, STATUS_REGISTER_T);
+        if (traceLevel == cpu_trace_level::OFF)
+            return isThumb ? decode_thumb_instruction<false>() : decode_arm_instruction<false>();
         else
-            return decode_arm_instruction();
+            return isThumb ? decode_thumb_instruction<true>() : decode_arm_instruction<true>();
+    }
+
+    const u32 cpu::run(const u32& _cycles)
+    {
+        u64 instructions = 0;
+        return run_budget<false>(_cycles, instructions);
+    }
+
+    const u32 cpu::run(const u32& _cycles, u64& _instructions)
+    {
+        return run_budget<true>(_cycles, _instructions);
+    }
+
+    const u32 cpu::run_block(u64& _instructions)
+    {
+        // the other backends and traced runs end the run after one instruction with a budget of one cycle
+        if (backend != cpu_backend::RECOMPILER || traceLevel != cpu_trace_level::OFF)
+            return run_budget<true>(1, _instructions);
+
+        runLimit = UINT32_MAX;
+        runCycles = 0;
+        runInstructions = 0;
+        idle = false;
+        if (_instructions != 0 && !halted)
+        {
+            if (irqPending)
+                trigger_exception(cpu_exception::IRQ);
+
+            runBudget = runLimit;
+            run_recompiled_block<true>(_instructions);
+        }
+
+        _instructions -= runInstructions;
+
+        u32 cycles = runCycles;
+        runCycles = 0;
+        return cycles;
     }
 
     void cpu::reset()
@@ -34,7 +72,89 @@ namespace br::gba
 
         trigger_exception(cpu_exception::FIQ);
     }
+
+    void cpu::set_irq_line(const bool& _requested)
+    {
+        irqLine = _requested;
+        update_irq_pending();
+    }
+
+    const u32 cpu::get_run_cycles()
+    {
+        return runCycles;
+    }
+
+    void cpu::end_run()
+    {
+        runLimit = runCycles;
+        runBudget = 0;
+    }
+
+    void cpu::halt()
+    {
+        halted = true;
+        runBudget = 0;
+    }
+
+    void cpu::resume()
+    {
+        halted = false;
+    }
+
+    const bool cpu::is_halted()
+    {
+        return halted;
+    }
+
+    const bool cpu::is_idle()
+    {
+        return idle;
+    }
+
+    void cpu::set_idle_detection(const bool& _enabled)
+    {
+        idleDetection = _enabled;
+        idleLoopKey = CODE_CACHE_EMPTY;
+        idleLoop = nullptr;
+    }
+
+    const bool cpu::get_idle_detection()
+    {
+        return idleDetection;
+    }
     
+    void cpu::set_backend(const cpu_backend& _backend)
+    {
+        backend = _backend;
+        if (backend == cpu_backend::RECOMPILER && !blockRecompiler.allocate())
+            backend = cpu_backend::CACHED;
+
+        // the interpreter must not keep fetching from the last page
+        currentCodePage = nullptr;
+        currentCodePageKey = CODE_CACHE_EMPTY;
+    }
+
+    const cpu_backend cpu::get_backend()
+    {
+        return backend;
+    }
+
+    void cpu::set_trace_level(const cpu_trace_level& _level, const u32& _bufferLength)
+    {
+        traceLevel = _level;
+        traceBuffer.clear();
+        traceBuffer.shrink_to_fit();
+        if (_level != cpu_trace_level::OFF)
+            traceBuffer.resize(std::max(_bufferLength, 1u));
+        traceHead = 0;
+        traceCount = 0;
+    }
+
+    const cpu_trace_level cpu::get_trace_level()
+    {
+        return traceLevel;
+    }
+
     const std::string cpu::debug_print_status()
     {
         std::stringstream statusInfo;
@@ -57,21 +177,53 @@ namespace br::gba
         if (!file.good())
             return;
 
-        file << debugLog;
+        u32 bufferLength = traceBuffer.size();
+        u32 first = bufferLength == 0 ? 0 : (traceHead + bufferLength - traceCount) % bufferLength;
+        for (u32 i = 0; i < traceCount; ++i)
+        {
+            const cpu_trace_record& record = traceBuffer[(first + i) % bufferLength];
+            cpu_instruction instruction = {};
+            if (record.isThumb && record.isaIndex < THUMB_ISA_COUNT)
+                instruction = thumbISA[record.isaIndex];
+            else if (!record.isThumb && record.isaIndex < ARM_ISA_COUNT)
+                instruction = armISA[record.isaIndex];
+
+            file << "\nOpcode: 0x" << std::setfill('0') << std::setw(8) << std::hex << record.opcode;
+            file << "\nInst Test: 0x" << std::setfill('0') << std::setw(8) << std::hex << instruction.data_test;
+            file << "\nInst Type: " << instruction.debug_info << '\n';
+
+            if (traceLevel != cpu_trace_level::FULL)
+                continue;
+
+            for (u32 r = 0; r < REGISTER_LIST_LENGTH; ++r)
+            {
+                file << "Register " + std::to_string(r) + ": 0x";
+                file << std::setfill('0') << std::setw(8) << std::hex << record.registers[r];
+                file << '\n';
+            }
+            file << debug_format_status_registers(record.statusRegister, record.savedStatusRegisters.data()) << '\n';
+        }
 
         file.close();
     }
 
-    void cpu::debug_log_cycle(const u32& _opcode, const cpu_instruction& _instruction)
+    void cpu::debug_log_cycle(const u32& _opcode, const u32& _isaIndex, const bool& _isThumb)
     {
-        std::stringstream statusInfo;
-        statusInfo << "Opcode: 0x" << std::setfill('0') << std::setw(8) << std::hex << _opcode;
-        statusInfo << "\nInst Test: 0x" << std::setfill('0') << std::setw(8) << std::hex << _instruction.data_test;
-        statusInfo << "\nInst Type: " << _instruction.debug_info;
+        cpu_trace_record& record = traceBuffer[traceHead];
+        record.opcode = _opcode;
+        record.isaIndex = _isaIndex;
+        record.isThumb = _isThumb;
+
+        if (traceLevel == cpu_trace_level::FULL)
+        {
+            materialize_flags();
+            std::copy(std::begin(registers), std::end(registers), record.registers.begin());
+            std::copy(std::begin(savedStatusRegisters), std::end(savedStatusRegisters), record.savedStatusRegisters.begin());
+            record.statusRegister = statusRegister;
+        }
 
-        debugLog += '\n';
-        debugLog += statusInfo.str() + '\n';
-        debugLog += debug_print_status() + '\n';
+        traceHead = (traceHead + 1) % traceBuffer.size();
+        traceCount = std::min<u32>(traceCount + 1, traceBuffer.size());
     }
 
     const std::string cpu::debug_print_isa(const bool& _armISA)
@@ -90,6 +242,13 @@ namespace br::gba
     }
 
     const std::string cpu::debug_print_status_registers()
+    {
+        materialize_flags();
+
+        return debug_format_status_registers(statusRegister, savedStatusRegisters);
+    }
+
+    const std::string cpu::debug_format_status_registers(const u32& _statusRegister, const u32* _savedStatusRegisters)
     {
         std::array<char, ARM_WORD_BIT_LENGTH> statusSymbols;
         statusSymbols.fill('-');
@@ -121,12 +280,12 @@ namespace br::gba
             if ((x <= 26 && x >= 8))
                 continue;
 
-            statusRegisters[(u32)cpu_mode::FIQ] += ((savedStatusRegisters[(u32)cpu_mode::FIQ] >> x) & 0b1) ? symbol : '-';
-            statusRegisters[(u32)cpu_mode::IRQ] += ((savedStatusRegisters[(u32)cpu_mode::IRQ] >> x) & 0b1) ? symbol : '-';
-            statusRegisters[(u32)cpu_mode::SUPERVISOR] += ((savedStatusRegisters[(u32)cpu_mode::SUPERVISOR] >> x) & 0b1) ? symbol : '-';
-            statusRegisters[(u32)cpu_mode::ABORT] += ((savedStatusRegisters[(u32)cpu_mode::ABORT] >> x) & 0b1) ? symbol : '-';
-            statusRegisters[(u32)cpu_mode::UNDEFINED] += ((savedStatusRegisters[(u32)cpu_mode::UNDEFINED] >> x) & 0b1) ? symbol : '-';
-            statusRegisters[5] += ((statusRegister >> x) & 0b1) ? symbol : '-';
+            statusRegisters[(u32)cpu_mode::FIQ] += ((_savedStatusRegisters[(u32)cpu_mode::FIQ] >> x) & 0b1) ? symbol : '-';
+            statusRegisters[(u32)cpu_mode::IRQ] += ((_savedStatusRegisters[(u32)cpu_mode::IRQ] >> x) & 0b1) ? symbol : '-';
+            statusRegisters[(u32)cpu_mode::SUPERVISOR] += ((_savedStatusRegisters[(u32)cpu_mode::SUPERVISOR] >> x) & 0b1) ? symbol : '-';
+            statusRegisters[(u32)cpu_mode::ABORT] += ((_savedStatusRegisters[(u32)cpu_mode::ABORT] >> x) & 0b1) ? symbol : '-';
+            statusRegisters[(u32)cpu_mode::UNDEFINED] += ((_savedStatusRegisters[(u32)cpu_mode::UNDEFINED] >> x) & 0b1) ? symbol : '-';
+            statusRegisters[5] += ((_statusRegister >> x) & 0b1) ? symbol : '-';
         }
 
         std::string registers;
@@ -138,50 +297,494 @@ namespace br::gba
         return registers;
     }
 
-    const u32 cpu::decode_arm_instruction()
+    template <bool COUNT_INSTRUCTIONS>
+    const u32 cpu::run_budget(const u32& _cycles, u64& _instructions)
     {
-        u32 opcode = addressBus.read_32(programCounter);
-        programCounter += ARM_WORD_LENGTH;
+        runLimit = _cycles;
+        runCycles = 0;
+        runInstructions = 0;
+        idle = false;
+        while (runCycles < runLimit && (!COUNT_INSTRUCTIONS || runInstructions < _instructions) && !halted && !idle)
+        {
+            // the only test for irqs, pending irqs end the loops below
+            if (irqPending)
+                trigger_exception(cpu_exception::IRQ);
+
+            runBudget = runLimit;
+
+            bool isThumb = get_bit_bool(statusRegister, STATUS_REGISTER_T);
+            bool isTrace = traceLevel != cpu_trace_level::OFF;
+            if (isTrace)
+                isThumb ? run_loop<true, true, COUNT_INSTRUCTIONS>(_instructions) : run_loop<false, true, COUNT_INSTRUCTIONS>(_instructions);
+            else if (backend == cpu_backend::RECOMPILER)
+                run_recompiled<COUNT_INSTRUCTIONS>(_instructions);
+            else
+                isThumb ? run_loop<true, false, COUNT_INSTRUCTIONS>(_instructions) : run_loop<false, false, COUNT_INSTRUCTIONS>(_instructions);
+        }
+
+        if constexpr (COUNT_INSTRUCTIONS)
+            _instructions -= runInstructions;
 
-        for (u32 i = 0; i < ARM_ISA_COUNT; ++i)
+        // the scheduler is advanced by the returned cycles, they must not be counted twice
+        u32 cycles = runCycles;
+        runCycles = 0;
+        return cycles;
+    }
+
+    template <bool THUMB, bool TRACE, bool COUNT_INSTRUCTIONS>
+    void cpu::run_loop(const u64& _instructions)
+    {
+        while (runCycles < runBudget)
         {
-            cpu_instruction currentInstruction = armISA[i];
+            if constexpr (COUNT_INSTRUCTIONS)
+            {
+                if (runInstructions == _instructions)
+                    return;
+                ++runInstructions;
+            }
 
-            if ((currentInstruction.data_mask & opcode) == currentInstruction.data_test)
+            if constexpr (THUMB)
+                runCycles += decode_thumb_instruction<TRACE>();
+            else
+                runCycles += decode_arm_instruction<TRACE>();
+        }
+    }
+
+    template <bool COUNT_INSTRUCTIONS>
+    void cpu::run_recompiled(const u64& _instructions)
+    {
+        while (runCycles < runBudget && (!COUNT_INSTRUCTIONS || runInstructions != _instructions))
+            run_recompiled_block<COUNT_INSTRUCTIONS>(_instructions);
+    }
+
+    template <bool COUNT_INSTRUCTIONS>
+    void cpu::run_recompiled_block(const u64& _instructions)
+    {
+        // blocks add their own cycles and instructions, they are only entered when all of their instructions fit the count
+        bool isThumb = get_bit_bool(statusRegister, STATUS_REGISTER_T);
+        recompiler_block* block = blockRecompiler.get_block(registers[REGISTER_PROGRAM_COUNTER_INDEX], isThumb);
+        if (block != nullptr && (!COUNT_INSTRUCTIONS || block->instructionCount <= _instructions - runInstructions))
+        {
+            blockRecompiler.execute(*block);
+            return;
+        }
+
+        // cold code runs up to its next jump, blocks are only looked up where execution can enter them
+        u32 nextAddress = 0;
+        do
+        {
+            if constexpr (COUNT_INSTRUCTIONS)
             {
-                u32 cycleCount = 0;
-                cycleCount = currentInstruction.execute(opcode);
-                debug_log_cycle(opcode, currentInstruction);
-                return cycleCount;
+                if (runInstructions == _instructions)
+                    return;
+                ++runInstructions;
             }
+
+            nextAddress = registers[REGISTER_PROGRAM_COUNTER_INDEX] + (isThumb ? THUMB_WORD_LENGTH : ARM_WORD_LENGTH);
+            runCycles += isThumb ? decode_thumb_instruction<false>() : decode_arm_instruction<false>();
+        } while (registers[REGISTER_PROGRAM_COUNTER_INDEX] == nextAddress && runCycles < runBudget);
+    }
+
+    template <bool TRACE>
+    const u32 cpu::decode_arm_instruction()
+    {
+        cpu_decoded_instruction uncachedInstruction = { nullptr, 0, CODE_CACHE_EMPTY };
+        cpu_decoded_instruction* instruction = get_cached_instruction(false);
+        if (instruction == nullptr)
+            instruction = &uncachedInstruction;
+
+        u32 fetchAddress = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+        if (instruction->isaIndex == CODE_CACHE_EMPTY)
+            decode_arm_opcode(addressBus.read_32(fetchAddress), *instruction);
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] += ARM_WORD_LENGTH;
+
+        // every instruction takes at least the fetch of the next one
+        u32 cycleCount = addressBus.get_access_cycles(fetchAddress, bus_access::SEQUENTIAL_32);
+
+        // copied out as the handler may write to the page and invalidate the entry
+        u32 opcode = instruction->opcode;
+        u32 isaIndex = instruction->isaIndex;
+        if (isaIndex >= ARM_ISA_COUNT)
+        {
+            if constexpr (TRACE)
+                debug_log_cycle(opcode, isaIndex, false);
+            return cycleCount;
         }
 
-        debug_log_cycle(opcode, {});
+        // instructions failing their condition never reach their handler
+        if (check_condition(opcode >> ARM_CONDITION_SHIFT))
+            cycleCount += (this->*instruction->execute)(opcode);
 
-        return 0;
+        // anything writing the program counter flushes the pipeline
+        if (registers[REGISTER_PROGRAM_COUNTER_INDEX] != fetchAddress + ARM_WORD_LENGTH)
+            cycleCount += complete_jump(fetchAddress, false);
+        if constexpr (TRACE)
+            debug_log_cycle(opcode, isaIndex, false);
+        return cycleCount;
     }
 
+    template <bool TRACE>
     const u32 cpu::decode_thumb_instruction()
     {
-        u16 opcode = addressBus.read_16(programCounter);
-        programCounter += THUMB_WORD_LENGTH;
+        cpu_decoded_instruction uncachedInstruction = { nullptr, 0, CODE_CACHE_EMPTY };
+        cpu_decoded_instruction* instruction = get_cached_instruction(true);
+        if (instruction == nullptr)
+            instruction = &uncachedInstruction;
+
+        u32 fetchAddress = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+        if (instruction->isaIndex == CODE_CACHE_EMPTY)
+            decode_thumb_opcode(addressBus.read_16(fetchAddress), *instruction);
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] += THUMB_WORD_LENGTH;
+
+        u32 cycleCount = addressBus.get_access_cycles(fetchAddress, bus_access::SEQUENTIAL_16);
+
+        // copied out as the handler may write to the page and invalidate the entry
+        u32 opcode = instruction->opcode;
+        u32 isaIndex = instruction->isaIndex;
+        if (isaIndex >= THUMB_ISA_COUNT)
+        {
+            if constexpr (TRACE)
+                debug_log_cycle(opcode, isaIndex, true);
+            return cycleCount;
+        }
+
+        cycleCount += (this->*instruction->execute)(opcode);
+
+        if (registers[REGISTER_PROGRAM_COUNTER_INDEX] != fetchAddress + THUMB_WORD_LENGTH)
+            cycleCount += complete_jump(fetchAddress, true);
+        if constexpr (TRACE)
+            debug_log_cycle(opcode, isaIndex, true);
+        return cycleCount;
+    }
+
+    void cpu::decode_arm_opcode(const u32& _opcode, cpu_decoded_instruction& _instruction)
+    {
+        _instruction.opcode = _opcode;
+        _instruction.execute = nullptr;
+
+        // the table entry matches outright unless its mask tests bits outside of the index (e.g. BX),
+        // only then does decoding fall through to the entries after it
+        u32 decodeIndex = arm_decode_index(_opcode);
+        u32 isaIndex = armDecodeTable[decodeIndex];
+        for (; isaIndex < ARM_ISA_COUNT; ++isaIndex)
+        {
+            const cpu_instruction& currentInstruction = armISA[isaIndex];
+
+            if ((currentInstruction.data_mask & _opcode) == currentInstruction.data_test)
+            {
+                bool isTableEntry = isaIndex == armDecodeTable[decodeIndex];
+                _instruction.execute = isTableEntry ? armHandlerTable[decodeIndex] : currentInstruction.specialize(decodeIndex);
+                break;
+            }
+        }
+
+        _instruction.isaIndex = isaIndex;
+    }
+
+    void cpu::decode_thumb_opcode(const u32& _opcode, cpu_decoded_instruction& _instruction)
+    {
+        // no thumb mask tests bits below the index, so the table entry is always the match
+        u32 decodeIndex = thumb_decode_index(_opcode);
+        _instruction.opcode = _opcode;
+        _instruction.execute = thumbHandlerTable[decodeIndex];
+        _instruction.isaIndex = thumbDecodeTable[decodeIndex];
+    }
 
-        for (u32 i = 0; i < THUMB_ISA_COUNT; ++i)
+    cpu_decoded_instruction* cpu::get_cached_instruction(const bool& _isThumb)
+    {
+        // the cache is indexed by halfword, an odd program counter would alias its neighbour so its key never matches a page
+        u32 address = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+        u32 pageKey = (address & ~(MEMORY_CODE_PAGE_SIZE - 1)) | ((address & 0b1) << 1) | _isThumb;
+        if (currentCodePageKey != pageKey)
         {
-            cpu_instruction currentInstruction = thumbISA[i];
+            if (backend == cpu_backend::INTERPRETER || (address & 0b1))
+                return nullptr;
 
-            if ((currentInstruction.data_mask & opcode) == currentInstruction.data_test)
+            auto page = codeCache.find(pageKey);
+            if (page == codeCache.end())
             {
-                u32 cycleCount = 0;
-                cycleCount = currentInstruction.execute(opcode);
-                debug_log_cycle(opcode, currentInstruction);
-                return cycleCount;
+                if (!addressBus.add_code_page(address))
+                    return nullptr;
+
+                page = codeCache.emplace(pageKey, cpu_code_page{}).first;
+                reset_code_page(page->second, address);
             }
+
+            currentCodePage = &page->second;
+            currentCodePageKey = pageKey;
         }
 
-        debug_log_cycle(opcode, {});
+        // pages written to since they were decoded are decoded again, also catching code writing its own page
+        if (currentCodePage->generation != *currentCodePage->generationSource)
+            reset_code_page(*currentCodePage, address);
 
-        return 0;
+        return &currentCodePage->instructions[(address & (MEMORY_CODE_PAGE_SIZE - 1)) >> 1];
+    }
+
+    void cpu::reset_code_page(cpu_code_page& _page, const u32& _address)
+    {
+        for (cpu_decoded_instruction& instruction : _page.instructions)
+            instruction.isaIndex = CODE_CACHE_EMPTY;
+
+        // the write that made the page stale also unmarked it
+        addressBus.add_code_page(_address);
+        _page.generationSource = addressBus.get_code_generation_source(_address);
+        _page.generation = *_page.generationSource;
+    }
+
+    void cpu::test_idle_loop(const u32& _branchAddress, const bool& _isThumb)
+    {
+        u32 loopKey = _branchAddress | _isThumb;
+        u32 readCount = addressBus.get_io_read_count();
+        bool isRepeated = loopKey == idleLoopKey && readCount == idleReadCount;
+        idleReadCount = readCount;
+        if (loopKey != idleLoopKey)
+        {
+            idleLoopKey = loopKey;
+            idleLoop = nullptr;
+        }
+
+        // the first time the branch is taken the loop may have been entered halfway
+        if (!isRepeated)
+            return;
+
+        u32 start = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+        bool isStale = idleLoop != nullptr && (idleLoop->startGeneration != addressBus.get_code_generation(start) || idleLoop->endGeneration != addressBus.get_code_generation(_branchAddress));
+        if (idleLoop == nullptr || isStale)
+            idleLoop = get_idle_loop(start, _branchAddress, _isThumb);
+
+        if (idleLoop->isIdle)
+        {
+            idle = true;
+            runBudget = 0;
+        }
+    }
+
+    cpu_idle_loop* cpu::get_idle_loop(const u32& _start, const u32& _end, const bool& _isThumb)
+    {
+        u32 startGeneration = addressBus.get_code_generation(_start);
+        u32 endGeneration = addressBus.get_code_generation(_end);
+        auto cachedLoop = idleLoops.find(_end | _isThumb);
+        if (cachedLoop != idleLoops.end() && cachedLoop->second.startGeneration == startGeneration && cachedLoop->second.endGeneration == endGeneration)
+            return &cachedLoop->second;
+
+        cpu_idle_loop& loop = idleLoops[_end | _isThumb];
+
+        // marked as code so writes to the loop advance the generations
+        if (!addressBus.add_code_page(_start) || !addressBus.add_code_page(_end))
+        {
+            loop = { false, startGeneration, endGeneration };
+            return &loop;
+        }
+
+        loop.isIdle = _isThumb ? analyse_thumb_loop(_start, _end) : analyse_arm_loop(_start, _end);
+        loop.startGeneration = startGeneration;
+        loop.endGeneration = endGeneration;
+        return &loop;
+    }
+
+    const bool cpu::analyse_arm_loop(const u32& _start, const u32& _end)
+    {
+        constexpr u32 flags = 1 << REGISTER_LIST_LENGTH;
+
+        // registers read before the loop wrote them in the same iteration carry values between iterations
+        u32 written = 0;
+        u32 readFirst = 0;
+        auto read = [&](const u32& _registers) { readFirst |= _registers & ~written; };
+        auto write = [&](const u32& _registers) { written |= _registers; };
+
+        for (u32 address = _start; address <= _end; address += ARM_WORD_LENGTH)
+        {
+            u32 opcode = addressBus.read_32(address);
+            cpu_decoded_instruction instruction;
+            decode_arm_opcode(opcode, instruction);
+            if (instruction.isaIndex >= ARM_ISA_COUNT)
+                return false;
+
+            u32 regN = 1 << ((opcode >> 16) & 0b1111);
+            u32 regDIndex = (opcode >> 12) & 0b1111;
+            u32 regS = 1 << ((opcode >> 8) & 0b1111);
+            u32 regM = 1 << (opcode & 0b1111);
+            bool isLoad = get_bit_bool(opcode, 1 << 20);
+            bool isPreOffset = get_bit_bool(opcode, 1 << 24);
+            bool isWriteBack = get_bit_bool(opcode, 1 << 21);
+
+            if ((opcode >> ARM_CONDITION_SHIFT) != 0xE)
+                read(flags);
+
+            u32 format = armISA[instruction.isaIndex].data_test;
+            switch (format)
+            {
+            case ARM_DATAPROC_1_TEST:
+            case ARM_DATAPROC_2_TEST:
+            case ARM_DATAPROC_3_TEST:
+            {
+                u32 dataOpcode = (opcode >> 21) & 0b1111;
+                // TST, TEQ, CMP, CMN
+                bool isCompare = dataOpcode >= 0x8 && dataOpcode <= 0xB;
+                // MOV, MVN
+                bool isMove = dataOpcode == 0xD || dataOpcode == 0xF;
+                // ADC, SBC, RSC
+                bool usesCarry = dataOpcode >= 0x5 && dataOpcode <= 0x7;
+                if (!isCompare && regDIndex == REGISTER_PROGRAM_COUNTER_INDEX)
+                    return false;
+
+                read((isMove ? 0 : regN) | (format != ARM_DATAPROC_3_TEST ? regM : 0) | (format == ARM_DATAPROC_2_TEST ? regS : 0) | (usesCarry ? flags : 0));
+                write((isCompare ? 0 : 1 << regDIndex) | (get_bit_bool(opcode, 1 << 20) ? flags : 0));
+                break;
+            }
+            case ARM_TRANSFER_1_TEST:
+            case ARM_TRANSFER_2_TEST:
+            case ARM_TRANSFER_3_TEST:
+            case ARM_TRANSFER_4_TEST:
+            {
+                // loads without writeback, the register offset forms read the offset register
+                bool isRegisterOffset = format == ARM_TRANSFER_1_TEST || format == ARM_TRANSFER_3_TEST;
+                if (!isLoad || !isPreOffset || isWriteBack || regDIndex == REGISTER_PROGRAM_COUNTER_INDEX)
+                    return false;
+
+                read(regN | (isRegisterOffset ? regM : 0));
+                write(1 << regDIndex);
+                break;
+            }
+            case ARM_BRANCHING_2_TEST:
+            {
+                // only the loop branch and branches leaving the loop
+                s32 offset = ((s32)opcode << 8) >> 6;
+                u32 target = address + ARM_WORD_LENGTH * 2 + offset;
+                bool isLink = get_bit_bool(opcode, 1 << 24);
+                if (isLink || (address != _end && target <= _end))
+                    return false;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        return (readFirst & written) == 0;
+    }
+
+    const bool cpu::analyse_thumb_loop(const u32& _start, const u32& _end)
+    {
+        constexpr u32 flags = 1 << REGISTER_LIST_LENGTH;
+        constexpr u32 stackPointer = 1 << REGISTER_STACK_POINTER_INDEX;
+
+        u32 written = 0;
+        u32 readFirst = 0;
+        auto read = [&](const u32& _registers) { readFirst |= _registers & ~written; };
+        auto write = [&](const u32& _registers) { written |= _registers; };
+
+        for (u32 address = _start; address <= _end; address += THUMB_WORD_LENGTH)
+        {
+            u32 opcode = addressBus.read_16(address);
+            cpu_decoded_instruction instruction;
+            decode_thumb_opcode(opcode, instruction);
+            if (instruction.isaIndex >= THUMB_ISA_COUNT)
+                return false;
+
+            u32 regD = 1 << (opcode & 0b111);
+            u32 regS = 1 << ((opcode >> 3) & 0b111);
+            u32 regO = 1 << ((opcode >> 6) & 0b111);
+            u32 regHi = 1 << ((opcode >> 8) & 0b111);
+            bool isLoad = get_bit_bool(opcode, 1 << 11);
+
+            switch (thumbISA[instruction.isaIndex].data_test)
+            {
+            case THUMB_SHIFT_TEST:
+                read(regS);
+                write(regD | flags);
+                break;
+            case THUMB_DATA_REG_TEST:
+                read(regS | (get_bit_bool(opcode, 1 << 10) ? 0 : regO));
+                write(regD | flags);
+                break;
+            case THUMB_DATA_IMM_TEST:
+            {
+                // MOV, CMP, ADD, SUB
+                u32 dataType = (opcode >> 11) & 0b11;
+                read(dataType != 0 ? regHi : 0);
+                write((dataType != 1 ? regHi : 0) | flags);
+                break;
+            }
+            case THUMB_DATA_ALU_TEST:
+            {
+                u32 aluType = (opcode >> 6) & 0b1111;
+                // TST, CMP, CMN
+                bool isCompare = aluType == 0x8 || aluType == 0xA || aluType == 0xB;
+                // NEG, MVN
+                bool isUnary = aluType == 0x9 || aluType == 0xF;
+                // ADC, SBC
+                bool usesCarry = aluType == 0x5 || aluType == 0x6;
+                read(regS | (isUnary ? 0 : regD) | (usesCarry ? flags : 0));
+                write((isCompare ? 0 : regD) | flags);
+                break;
+            }
+            case THUMB_DATA_HI_TEST:
+            {
+                // ADD, CMP, MOV, BX
+                u32 operationType = (opcode >> 8) & 0b11;
+                u32 regDIndex = (opcode & 0b111) | ((opcode >> 4) & 0b1000);
+                u32 regSIndex = (opcode >> 3) & 0b1111;
+                if (operationType == 0x3 || regDIndex == REGISTER_PROGRAM_COUNTER_INDEX)
+                    return false;
+
+                read((1 << regSIndex) | (operationType != 0x2 ? 1 << regDIndex : 0));
+                write(operationType == 0x1 ? flags : 1 << regDIndex);
+                break;
+            }
+            case THUMB_DATA_ADR_TEST:
+                read(isLoad ? stackPointer : 0);
+                write(regHi);
+                break;
+            case THUMB_TRANS_RELATIVE_TEST:
+                write(regHi);
+                break;
+            case THUMB_TRANS_SINGLE_TEST:
+                if (!isLoad)
+                    return false;
+                read(regS | regO);
+                write(regD);
+                break;
+            case THUMB_TRANS_EXTENDED_TEST:
+                // STRH
+                if (((opcode >> 10) & 0b11) == 0)
+                    return false;
+                read(regS | regO);
+                write(regD);
+                break;
+            case THUMB_TRANS_IMM_TEST:
+            case THUMB_TRANS_HALF_TEST:
+                if (!isLoad)
+                    return false;
+                read(regS);
+                write(regD);
+                break;
+            case THUMB_TRANS_STACK_TEST:
+                if (!isLoad)
+                    return false;
+                read(stackPointer);
+                write(regHi);
+                break;
+            case THUMB_COND_BRANCH_TEST:
+            {
+                s32 offset = (s8)(opcode & 0xFF) * 2;
+                u32 target = address + THUMB_WORD_LENGTH + offset;
+                read(flags);
+                if (address != _end && target <= _end)
+                    return false;
+                break;
+            }
+            case THUMB_BRANCH_TEST:
+                if (address != _end)
+                    return false;
+                break;
+            default:
+                return false;
+            }
+        }
+
+        return (readFirst & written) == 0;
     }
 
     const u32 cpu::debug_get_register(const u32& _index)
@@ -191,39 +794,141 @@ namespace br::gba
 
     u32& cpu::get_register(const u32& _index, const bool& _forceUser)
     {
+        if (!_forceUser)
+            return registers[_index];
+
+        // user registers of a privileged mode are only banked from 8 - 14
         cpu_mode mode = get_current_mode();
-        bool is_not_user = mode != cpu_mode::USER && mode != cpu_mode::SYSTEM && !_forceUser;
-        bool is_fiq = mode == cpu_mode::FIQ && !_forceUser;
-    
-        u32 armRegisterOffset = REGISTER_ARM_OFFSET * is_fiq;
-        u32 bankedRegisterOffset = ((u32)mode + 1) * is_not_user;
+        bool isUser = mode == cpu_mode::USER || mode == cpu_mode::SYSTEM;
+        bool isBanked = _index == REGISTER_STACK_POINTER_INDEX || _index == REGISTER_LINK_INDEX || (_index >= 8 && mode == cpu_mode::FIQ);
+        if (isUser || !isBanked)
+            return registers[_index];
+
         switch (_index)
         {
-        case 0:
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-        case 6:
-        case 7:
-            return thumbRegisters[_index];
-        case 8:
-        case 9:
-        case 10:
-        case 11:
-        case 12:
-            return armRegisters[armRegisterOffset + (_index - 8)];
         case 13:
-            return stackPointers[bankedRegisterOffset];
+            return stackPointers[0];
         case 14:
-            return linkRegisters[bankedRegisterOffset];
-        case 15:
-            return programCounter;
+            return linkRegisters[0];
+        }
+
+        return armRegisters[_index - 8];
+    }
+
+    void cpu::set_status_register(const u32& _status)
+    {
+        // _status may be the current program status register itself
+        materialize_flags();
+
+        cpu_mode previousMode = get_current_mode();
+        set_thumb_state(get_bit_bool(_status, STATUS_REGISTER_T));
+        statusRegister = _status;
+
+        cpu_mode mode = get_current_mode();
+        if (mode != previousMode)
+            swap_register_bank(previousMode, mode);
+
+        update_irq_pending();
+    }
+
+    void cpu::set_thumb_state(const bool& _isThumb)
+    {
+        // the program counter can continue at the next address, so the write itself has to end the run loop
+        if (get_bit_bool(statusRegister, STATUS_REGISTER_T) != _isThumb)
+            runBudget = 0;
+
+        set_bit(statusRegister, STATUS_REGISTER_T_SHIFT, _isThumb);
+    }
+
+    void cpu::swap_register_bank(const cpu_mode& _previousMode, const cpu_mode& _mode)
+    {
+        bool wasUser = _previousMode == cpu_mode::USER || _previousMode == cpu_mode::SYSTEM;
+        bool isUser = _mode == cpu_mode::USER || _mode == cpu_mode::SYSTEM;
+
+        u32 previousArmOffset = REGISTER_ARM_OFFSET * (_previousMode == cpu_mode::FIQ);
+        u32 previousBankOffset = ((u32)_previousMode + 1) * !wasUser;
+        u32 armOffset = REGISTER_ARM_OFFSET * (_mode == cpu_mode::FIQ);
+        u32 bankOffset = ((u32)_mode + 1) * !isUser;
+
+        for (u32 i = 0; i < REGISTER_ARM_OFFSET; ++i)
+        {
+            armRegisters[previousArmOffset + i] = registers[8 + i];
+            registers[8 + i] = armRegisters[armOffset + i];
         }
 
-        // shouldn't ever manage to get past 15
-        return programCounter;
+        stackPointers[previousBankOffset] = registers[REGISTER_STACK_POINTER_INDEX];
+        linkRegisters[previousBankOffset] = registers[REGISTER_LINK_INDEX];
+        registers[REGISTER_STACK_POINTER_INDEX] = stackPointers[bankOffset];
+        registers[REGISTER_LINK_INDEX] = linkRegisters[bankOffset];
+    }
+
+    void cpu::defer_flags(const cpu_flag_operation& _operation, const u32& _result, const u32& _operandA, const u32& _operandB, const u32& _carry)
+    {
+        // logical operations and short multiplies keep the previous overflow flag
+        bool keepsOverflow = _operation == cpu_flag_operation::LOGICAL || _operation == cpu_flag_operation::MULTIPLY;
+        bool hasOverflow = flagOperation != cpu_flag_operation::NONE && flagOperation != cpu_flag_operation::LOGICAL && flagOperation != cpu_flag_operation::MULTIPLY;
+        if (keepsOverflow && hasOverflow)
+            materialize_flags();
+
+        flagOperation = _operation;
+        flagResult = _result;
+        flagOperandA = _operandA;
+        flagOperandB = _operandB;
+        flagCarry = _carry;
+    }
+
+    void cpu::materialize_flags()
+    {
+        u32 negative = flagResult >> STATUS_REGISTER_N_SHIFT;
+        u32 zero = flagResult == 0;
+        u32 carry = flagCarry;
+        u32 overflow = get_bit_bool(statusRegister, STATUS_REGISTER_V);
+        switch (flagOperation)
+        {
+        case cpu_flag_operation::NONE:
+            return;
+        case cpu_flag_operation::LOGICAL:
+            break;
+        case cpu_flag_operation::ADD:
+            carry = test_carry_pos(flagOperandA, flagOperandB);
+            overflow = test_overflow_pos(flagOperandA, flagOperandB);
+            break;
+        case cpu_flag_operation::ADC:
+            carry = test_carry_pos(flagOperandA, flagOperandB, flagCarry);
+            overflow = test_overflow_pos(flagOperandA, flagOperandB, flagCarry);
+            break;
+        case cpu_flag_operation::SUB:
+            carry = test_carry_neg(flagOperandA, flagOperandB);
+            overflow = test_overflow_neg(flagOperandA, flagOperandB);
+            break;
+        case cpu_flag_operation::SBC:
+            carry = test_carry_neg(flagOperandA, flagOperandB, flagCarry);
+            overflow = test_overflow_neg(flagOperandA, flagOperandB, flagCarry);
+            break;
+        case cpu_flag_operation::MULTIPLY_LONG:
+            overflow = 0;
+            [[fallthrough]];
+        case cpu_flag_operation::MULTIPLY:
+            // 64 bit result, high word in flagResult
+            zero = (flagResult | flagOperandA) == 0;
+            carry = 0;
+            break;
+        }
+
+        const u32 flagsMask = STATUS_REGISTER_N | STATUS_REGISTER_Z | STATUS_REGISTER_C | STATUS_REGISTER_V;
+        statusRegister = (statusRegister & ~flagsMask)
+                        | (negative << STATUS_REGISTER_N_SHIFT)
+                        | (zero << STATUS_REGISTER_Z_SHIFT)
+                        | (carry << STATUS_REGISTER_C_SHIFT)
+                        | (overflow << STATUS_REGISTER_V_SHIFT);
+
+        flagOperation = cpu_flag_operation::NONE;
+    }
+
+    const u32 cpu::get_carry_flag()
+    {
+        materialize_flags();
+        return get_bit_bool(statusRegister, STATUS_REGISTER_C);
     }
 
     u32& cpu::get_current_spsr(bool& _isUserMode)
@@ -290,48 +995,14 @@ namespace br::gba
             break;
         }
 
-        statusRegister = (statusRegister & 0xFFFFFFE0) | modeStatus;
+        set_status_register((statusRegister & 0xFFFFFFE0) | modeStatus);
     }
 
     const bool cpu::check_condition(const u32& _code)
     {
-        switch (_code)
-        {
-        case 0: // EQ
-            return get_bit_bool(statusRegister, STATUS_REGISTER_Z);
-        case 1: // NE
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_Z);
-        case 2: // CS/HS
-            return get_bit_bool(statusRegister, STATUS_REGISTER_C);
-        case 3: // CC/LO
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_C);
-        case 4: // MI
-            return get_bit_bool(statusRegister, STATUS_REGISTER_N);
-        case 5: // PL
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_N);
-        case 6: // VS
-            return get_bit_bool(statusRegister, STATUS_REGISTER_V);
-        case 7: // VC
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_V);
-        case 8: // HI
-            return get_bit_bool(statusRegister, STATUS_REGISTER_C) && get_not_bit_bool(statusRegister, STATUS_REGISTER_Z);
-        case 9: // LS
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_C) || get_bit_bool(statusRegister, STATUS_REGISTER_Z);
-        case 10: // GE
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_N) == get_not_bit_bool(statusRegister, STATUS_REGISTER_V);
-        case 11: // LT
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_N) != get_not_bit_bool(statusRegister, STATUS_REGISTER_V);
-        case 12: // GT
-            return get_not_bit_bool(statusRegister, STATUS_REGISTER_Z) && (get_not_bit_bool(statusRegister, STATUS_REGISTER_N) == get_not_bit_bool(statusRegister, STATUS_REGISTER_V));
-        case 13: // LE
-            return get_bit_bool(statusRegister, STATUS_REGISTER_Z) && (get_not_bit_bool(statusRegister, STATUS_REGISTER_N) != get_not_bit_bool(statusRegister, STATUS_REGISTER_V));
-        case 14: // AL
-            return true;
-        case 15: // NV
-            return true;
-        }
-
-        return false;
+        materialize_flags();
+
+        return (CONDITION_TABLE[_code] >> (statusRegister >> STATUS_REGISTER_V_SHIFT)) & 0b1;
     }
 
     const u32 cpu::shift_operand(const u32& _shiftType, const bool& _zeroShift, const u32& _operand, const u32& _shift, u32& _carryFlag)
@@ -361,7 +1032,7 @@ namespace br::gba
                 if (_zeroShift) // RCR
                 {
                     operand >>= 1;
-                    operand |= (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C) << 31;
+                    operand |= get_carry_flag() << 31;
                 }
                 else
                 {
@@ -381,6 +1052,8 @@ namespace br::gba
 
     void cpu::trigger_exception(const cpu_exception& _exception)
     {
+        materialize_flags();
+
         u32 previousPSR = statusRegister;
         u32 exceptionVector = 0;
         bool disableFIQ = false;
@@ -414,28 +1087,77 @@ namespace br::gba
             break;
         }
 
-        get_register(REGISTER_LINK_INDEX) = programCounter;
+        // interrupts return with SUBS PC, LR, #4 in both instruction sets
+        bool isInterrupt = _exception == cpu_exception::IRQ || _exception == cpu_exception::FIQ;
+        get_register(REGISTER_LINK_INDEX) = registers[REGISTER_PROGRAM_COUNTER_INDEX] + (isInterrupt ? ARM_WORD_LENGTH : 0);
         
         bool isUserMode;
         get_current_spsr(isUserMode) = previousPSR;
 
-        set_bit(statusRegister, STATUS_REGISTER_T_SHIFT, 0);
+        set_thumb_state(false);
         set_bit(statusRegister, STATUS_REGISTER_I_SHIFT, 1);
         if (disableFIQ)
             set_bit(statusRegister, STATUS_REGISTER_F_SHIFT, 1);
 
-        programCounter = exceptionVector;
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] = exceptionVector;
+        update_irq_pending();
     }
 
-    const u32 cpu::arm_dataproc(const u32& _opcode)
+    void cpu::update_irq_pending()
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
+        irqPending = irqLine && !get_bit_bool(statusRegister, STATUS_REGISTER_I);
+        if (irqPending)
+            runBudget = 0;
+    }
+
+    const u32 cpu::get_data_cycles(const u32& _address, const u32& _size)
+    {
+        return addressBus.get_access_cycles(_address, _size == sizeof(u32) ? bus_access::NONSEQUENTIAL_32 : bus_access::NONSEQUENTIAL_16);
+    }
+
+    const u32 cpu::get_sequential_data_cycles(const u32& _address)
+    {
+        return addressBus.get_access_cycles(_address, bus_access::SEQUENTIAL_32);
+    }
+
+    const u32 cpu::get_refill_cycles()
+    {
+        u32 address = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+        if (get_bit_bool(statusRegister, STATUS_REGISTER_T))
+            return addressBus.get_access_cycles(address, bus_access::NONSEQUENTIAL_16) + addressBus.get_access_cycles(address + THUMB_WORD_LENGTH, bus_access::SEQUENTIAL_16);
+
+        return addressBus.get_access_cycles(address, bus_access::NONSEQUENTIAL_32) + addressBus.get_access_cycles(address + ARM_WORD_LENGTH, bus_access::SEQUENTIAL_32);
+    }
+
+    const u32 cpu::complete_jump(const u32& _fetchAddress, const bool& _isThumb)
+    {
+        u32 cycleCount = get_refill_cycles();
 
-        bool isImmediate = get_bit_bool(_opcode, 1 << 25);
-        bool setStatus = get_bit_bool(_opcode, 1 << 20);
+        // switching instruction set always writes the program counter, the run loop of the old one has to end
+        u32 wordLength = _isThumb ? THUMB_WORD_LENGTH : ARM_WORD_LENGTH;
+        if (get_bit_bool(statusRegister, STATUS_REGISTER_T) != _isThumb)
+            runBudget = 0;
+        else if (idleDetection && _fetchAddress - registers[REGISTER_PROGRAM_COUNTER_INDEX] < IDLE_LOOP_MAX_INSTRUCTIONS * wordLength)
+            test_idle_loop(_fetchAddress, _isThumb);
 
-        u32 dataOpcode = (_opcode >> 21) & 0b1111;
+        return cycleCount;
+    }
+
+    const u32 cpu::get_multiply_cycles(const u32& _multiplier, const bool& _signed)
+    {
+        u32 multiplier = _signed && (_multiplier >> 31) ? ~_multiplier : _multiplier;
+        if ((multiplier >> 8) == 0)
+            return 1;
+        if ((multiplier >> 16) == 0)
+            return 2;
+        if ((multiplier >> 24) == 0)
+            return 3;
+        return 4;
+    }
+
+    template <u32 DATA_OPCODE, bool IMMEDIATE, bool SHIFT_REGISTER, bool SET_STATUS>
+    const u32 cpu::arm_dataproc(const u32& _opcode)
+    {
         u32 regDIndex = (_opcode >> 12) & 0b1111;
         bool isProgramCounter = regDIndex == REGISTER_PROGRAM_COUNTER_INDEX;
 
@@ -444,7 +1166,7 @@ namespace br::gba
 
         u32 operand = 0;
         u32 carry = 0;
-        if (isImmediate)
+        if constexpr (IMMEDIATE)
         {
             u32 immediate = _opcode & 0xFF;
             u32 rotate = ((_opcode >> 8) & 0b1111) << 1;
@@ -454,13 +1176,12 @@ namespace br::gba
         }
         else
         {
-            bool shiftRegister = get_bit_bool(_opcode, 1 << 4);
             bool zeroShift = false;
             bool zeroShiftRegister = false;
             u32 shiftType = (_opcode >> 5) & 0b11;
             
             u32 shift;
-            if (shiftRegister)
+            if constexpr (SHIFT_REGISTER)
             {
                 shift = get_register((_opcode >> 8) & 0b1111) & 0xFF;
                 zeroShiftRegister = shift == 0;
@@ -479,143 +1200,124 @@ namespace br::gba
         }
 
         bool setRegister = false;
-        bool isLogical = false;
+        cpu_flag_operation flagOperation = cpu_flag_operation::LOGICAL;
+        u32 operandA = regN;
+        u32 operandB = operand;
         u32 result = 0;
-        u32 overflow = 0;
-        switch (dataOpcode)
+        switch (DATA_OPCODE)
         {
         case 0x0: // AND
             result = regN & operand;
             setRegister = true;
-            isLogical = true;
             break;
         case 0x1: // EOR
             result = regN ^ operand;
             setRegister = true;
-            isLogical = true;
             break;
         case 0x2: // SUB
             result = regN - operand;
-            overflow = test_overflow_neg(regN, operand);
-            carry = test_carry_neg(regN, operand);
+            flagOperation = cpu_flag_operation::SUB;
             setRegister = true;
             break;
         case 0x3: // RSB
             result = operand - regN;
-            overflow = test_overflow_neg(operand, regN);
-            carry = test_carry_neg(operand, regN);
+            flagOperation = cpu_flag_operation::SUB;
+            operandA = operand;
+            operandB = regN;
             setRegister = true;
             break;
         case 0x4: // ADD
             result = regN + operand;
-            overflow = test_overflow_pos(regN, operand);
-            carry = test_carry_pos(regN, operand);
+            flagOperation = cpu_flag_operation::ADD;
             setRegister = true;
             break;
         case 0x5: // ADC
-            result = regN + operand + (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C);
-            overflow = test_overflow_pos(regN, operand, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
-            carry = test_carry_pos(regN, operand, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
+            carry = get_carry_flag();
+            result = regN + operand + carry;
+            flagOperation = cpu_flag_operation::ADC;
             setRegister = true;
             break;
         case 0x6: // SBC
-            result = regN - operand + (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C) - 1;
-            overflow = test_overflow_neg(regN, operand, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
-            carry = test_carry_neg(regN, operand, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
+            carry = get_carry_flag();
+            result = regN - operand + carry - 1;
+            flagOperation = cpu_flag_operation::SBC;
             setRegister = true;
             break;
         case 0x7: // RSC
-            result = operand - regN + (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C) - 1;
-            overflow = test_overflow_neg(operand, regN, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
-            carry = test_carry_neg(operand, regN, (u32)get_bit_bool(statusRegister, STATUS_REGISTER_C));
+            carry = get_carry_flag();
+            result = operand - regN + carry - 1;
+            flagOperation = cpu_flag_operation::SBC;
+            operandA = operand;
+            operandB = regN;
             setRegister = true;
             break;
         case 0x8: // TST
             result = regN & operand;
-            isLogical = true;
             break;
         case 0x9: // TEQ
             result = regN ^ operand;
-            isLogical = true;
             break;
         case 0xA: // CMP
             result = regN - operand;
-            overflow = test_overflow_neg(regN, operand);
-            carry = test_carry_neg(regN, operand);
-            isLogical = true;
+            flagOperation = cpu_flag_operation::SUB;
             break;
         case 0xB: // CMN
             result = regN + operand;
-            overflow = test_overflow_pos(regN, operand);
-            carry = test_carry_pos(regN, operand);
-            isLogical = true;
+            flagOperation = cpu_flag_operation::ADD;
             break;
         case 0xC: // ORR
             result = regN | operand;
             setRegister = true;
-            isLogical = true;
             break;
         case 0xD: // MOV
             result = operand;
             setRegister = true;
-            isLogical = true;
             break;
         case 0xE: // BIC
             result = regN & ~operand;
             setRegister = true;
-            isLogical = true;
             break;
         case 0xF: // MVN
             result = ~operand;
             setRegister = true;
-            isLogical = true;
             break;
         }
 
         if (setRegister)
             regD = result;
 
-        if (setStatus)
+        if constexpr (SET_STATUS)
         {
             if (isProgramCounter)
             {
                 bool isUserMode;
-                statusRegister = get_current_spsr(isUserMode);
+                set_status_register(get_current_spsr(isUserMode));
             }
             else
             {
-                if (!isLogical)
-                    set_bit(statusRegister, STATUS_REGISTER_V_SHIFT, overflow);
-                set_bit(statusRegister, STATUS_REGISTER_C_SHIFT, carry);
-                set_bit(statusRegister, STATUS_REGISTER_Z_SHIFT, result == 0);
-                set_bit(statusRegister, STATUS_REGISTER_N_SHIFT, result >> STATUS_REGISTER_N_SHIFT);
+                defer_flags(flagOperation, result, operandA, operandB, carry);
             }
         }
 
-        return 0;
+        // shifting by a register takes an internal cycle
+        return SHIFT_REGISTER ? 1 : 0;
     }
 
+    template <bool LINK>
     const u32 cpu::arm_branch(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool setLink = get_bit_bool(_opcode, 1 << 24);
         s32 offset = ((s32)_opcode << 8) >> 6;
 
-        programCounter += ARM_WORD_LENGTH + offset;
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] += ARM_WORD_LENGTH + offset;
 
-        if (setLink)
-            get_register(REGISTER_LINK_INDEX) = programCounter;
+        if constexpr (LINK)
+            get_register(REGISTER_LINK_INDEX) = registers[REGISTER_PROGRAM_COUNTER_INDEX];
 
         return 0;
     }
 
     const u32 cpu::arm_branch_ex(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
         u32 branchType = (_opcode >> 4) & 0b1111;
         u32 regN = get_register(_opcode & 0b1111);
 
@@ -624,30 +1326,22 @@ namespace br::gba
         {
             bool thumbMode = regN & 0b1;
             
-            set_bit(statusRegister, STATUS_REGISTER_T_SHIFT, thumbMode);
+            set_thumb_state(thumbMode);
             
-            programCounter = regN - thumbMode;
+            registers[REGISTER_PROGRAM_COUNTER_INDEX] = regN - thumbMode;
         }
 
         return 0;
     }
 
+    template <bool IMMEDIATE, bool PRE_OFFSET, bool OFFSET_UP, bool BYTE_TRANSFER, bool WRITE_BACK, bool LOAD>
     const u32 cpu::arm_trans_single(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool isImmediate = get_not_bit_bool(_opcode, 1 << 25);
-        bool isPreOffset = get_bit_bool(_opcode, 1 << 24);
-        bool isByteTransfer = get_bit_bool(_opcode, 1 << 22);
-        bool isLoad = get_bit_bool(_opcode, 1 << 20);
-
-        u32 offsetSign = get_bit_bool(_opcode, 1 << 23);
         u32& regD = get_register((_opcode >> 12) & 0b1111);
         u32& regN = get_register((_opcode >> 16) & 0b1111);
 
         u32 offset = 0;
-        if (isImmediate)
+        if constexpr (IMMEDIATE)
         {
             offset = _opcode & 0xFFF;
         }
@@ -661,23 +1355,22 @@ namespace br::gba
         }
 
         u32 destAddress = regN;
-        if (isPreOffset)
+        if constexpr (PRE_OFFSET)
         {
-            destAddress = sub_or_add(destAddress, offset, offsetSign);
+            destAddress = sub_or_add(destAddress, offset, OFFSET_UP);
             
-            bool writeBack = get_bit_bool(_opcode, 1 << 21);
-            if (writeBack)
+            if constexpr (WRITE_BACK)
                 regN = destAddress;
         }
 
-        if (isLoad)
+        if constexpr (LOAD)
         {
             u32 data = addressBus.read_32(destAddress);
-            regD = isByteTransfer ? data & 0xFF : data;
+            regD = BYTE_TRANSFER ? data & 0xFF : data;
         }
         else
         {
-            if (isByteTransfer)
+            if constexpr (BYTE_TRANSFER)
             {
                 addressBus.write_8(destAddress, regD & 0xFF);
             }
@@ -687,31 +1380,27 @@ namespace br::gba
             }
         }
 
+        // loads take an internal cycle to write the register
+        u32 cycleCount = get_data_cycles(destAddress, BYTE_TRANSFER ? sizeof(u8) : sizeof(u32)) + LOAD;
+
         // post offset, writeback always enabled
-        if (!isPreOffset)
+        if constexpr (!PRE_OFFSET)
         {
-            destAddress = sub_or_add(destAddress, offset, offsetSign);
+            destAddress = sub_or_add(destAddress, offset, OFFSET_UP);
             regN = destAddress;
         }
 
-        return 0;
+        return cycleCount;
     }
 
+    template <bool PRE_OFFSET, bool OFFSET_UP, bool IMMEDIATE, bool WRITE_BACK, bool LOAD>
     const u32 cpu::arm_trans_half(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool isPreOffset = get_bit_bool(_opcode, 1 << 24);
-        bool isImmediate = get_bit_bool(_opcode, 1 << 22);
-        bool isLoad = get_bit_bool(_opcode, 1 << 20);
-
-        u32 offsetSign = get_bit_bool(_opcode, 1 << 23);
         u32& regD = get_register((_opcode >> 12) & 0b1111);
         u32& regN = get_register((_opcode >> 16) & 0b1111);
         
         u32 offset = 0;
-        if (isImmediate)
+        if constexpr (IMMEDIATE)
         {
             offset = ((_opcode >> 4) & 0xF0) | (_opcode & 0b1111);
         }
@@ -721,17 +1410,16 @@ namespace br::gba
         }
 
         u32 destAddress = regN;
-        if (isPreOffset)
+        if constexpr (PRE_OFFSET)
         {
-            destAddress = sub_or_add(destAddress, offset, offsetSign);
+            destAddress = sub_or_add(destAddress, offset, OFFSET_UP);
             
-            bool writeBack = get_bit_bool(_opcode, 1 << 21);
-            if (writeBack)
+            if constexpr (WRITE_BACK)
                 regN = destAddress;
         }
 
         u32 transType = (_opcode >> 5) & 0b11;
-        if (isLoad)
+        if constexpr (LOAD)
         {
             u32 data = 0;
             switch (transType)
@@ -758,27 +1446,25 @@ namespace br::gba
                 addressBus.write_16(destAddress, regN & 0xFFFF);
         }
 
-        if (!isPreOffset)
+        u32 cycleCount = get_data_cycles(destAddress, sizeof(u16)) + LOAD;
+
+        if constexpr (!PRE_OFFSET)
         {
-            destAddress = sub_or_add(destAddress, offset, offsetSign);
+            destAddress = sub_or_add(destAddress, offset, OFFSET_UP);
             regN = destAddress;
         }
 
-        return 0;
+        return cycleCount;
     }
 
+    template <bool BYTE_TRANSFER>
     const u32 cpu::arm_trans_swap(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool isByteTransfer = get_bit_bool(_opcode, 1 << 22);
-
         u32& regN = get_register((_opcode >> 16) & 0b1111);
         u32& regD = get_register((_opcode >> 12) & 0b1111);
         u32& regM = get_register(_opcode & 0b1111);
 
-        if (isByteTransfer)
+        if constexpr (BYTE_TRANSFER)
         {
             regD = addressBus.read_8(regN);
             addressBus.write_8(regN, regM & 0xFF);
@@ -789,70 +1475,67 @@ namespace br::gba
             addressBus.write_32(regN, regM);
         }
 
-        return 0;
+        return get_data_cycles(regN, BYTE_TRANSFER ? sizeof(u8) : sizeof(u32)) * 2 + 1;
     }
 
+    template <bool PRE_OFFSET, bool OFFSET_UP, bool USER_MODE, bool WRITE_BACK, bool LOAD>
     const u32 cpu::arm_trans_block(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
         bool containsPC = get_bit_bool(_opcode, 1 << 15);
-        bool isLoad = get_bit_bool(_opcode, 1 << 20);
-        bool isUserMode = get_bit_bool(_opcode, 1 << 22);
-        bool isPreOffset = get_bit_bool(_opcode, 1 << 24);
-        bool isModeChange = isLoad && containsPC && isUserMode;
-        bool useUserMode = isUserMode && !isModeChange;
-        bool writeBack = get_bit_bool(_opcode, 1 << 21) && !useUserMode;
+        bool isModeChange = LOAD && containsPC && USER_MODE;
+        bool useUserMode = USER_MODE && !isModeChange;
+        bool writeBack = WRITE_BACK && !useUserMode;
 
         u32& regN = get_register((_opcode >> 16) & 0b1111);
         u32 regList = _opcode & 0xFFFF;
 
-        u32 offsetSign = get_bit_bool(_opcode, 1 << 23);
-        u32 offset = bit_count(regList, REGISTER_LIST_LENGTH) * ARM_WORD_LENGTH;
+        u32 count = bit_count(regList, REGISTER_LIST_LENGTH);
+        u32 offset = count * ARM_WORD_LENGTH;
         
-        u32 destAddress = regN - bool_lerp(offset, 0, offsetSign);
+        // the listed registers occupy consecutive words, lowest register first
+        u32 destAddress = regN - bool_lerp(offset, 0, OFFSET_UP) + bool_lerp(0, ARM_WORD_LENGTH, PRE_OFFSET);
+        u32 blockData[REGISTER_LIST_LENGTH];
+
+        if constexpr (LOAD)
+            addressBus.read_block_32(destAddress, blockData, count);
+
+        u32 blockIndex = 0;
         for (u32 i = 0; i < REGISTER_LIST_LENGTH; ++i)
         {
             bool useRegister = (regList >> i) & 0b1;
 
             if (useRegister)
             {
-                destAddress += bool_lerp(0, ARM_WORD_LENGTH, isPreOffset);
-
                 u32& regData = get_register(i, useUserMode);
-                if (isLoad)
-                {
-                    regData = addressBus.read_32(destAddress);
-                }
+                if constexpr (LOAD)
+                    regData = blockData[blockIndex++];
                 else
-                {
-                    addressBus.write_32(destAddress, regData);
-                }
-
-                destAddress += bool_lerp(ARM_WORD_LENGTH, 0, isPreOffset);
+                    blockData[blockIndex++] = regData;
             }
         }
 
+        if constexpr (!LOAD)
+            addressBus.write_block_32(destAddress, blockData, count);
+
         if (writeBack)
-            regN = sub_or_add(regN, offset, offsetSign);
+            regN = sub_or_add(regN, offset, OFFSET_UP);
 
         if (isModeChange)
         {
             bool userMode;
-            statusRegister = get_current_spsr(userMode);
+            set_status_register(get_current_spsr(userMode));
         }
 
-        return 0;
+        if (count == 0)
+            return 0;
+
+        // the first word is nonsequential, the rest follow it
+        return get_data_cycles(destAddress, sizeof(u32)) + (count - 1) * get_sequential_data_cycles(destAddress) + LOAD;
     }
 
+    template <u32 MULTIPLY_TYPE, bool SET_STATUS>
     const u32 cpu::arm_multiply(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool setStatus = get_bit_bool(_opcode, 1 << 20);
-
         u32& regHi = get_register((_opcode >> 16) & 0b1111);
         u32& regLo = get_register((_opcode >> 12) & 0b1111);
         u64 regHiLo = ((u64)regHi << ARM_WORD_BIT_LENGTH) | regLo;
@@ -861,8 +1544,7 @@ namespace br::gba
 
         bool setRegLo = false;
         u64 result = 0;
-        u32 multiplyType = (_opcode >> 21) & 0b1111;
-        switch (multiplyType)
+        switch (MULTIPLY_TYPE)
         {
         case 0b0000: // MUL
             result = regM * regS;
@@ -899,35 +1581,28 @@ namespace br::gba
             result <<= ARM_WORD_BIT_LENGTH;
         }
 
-        if (setStatus)
-        {
-            if (setRegLo)
-                set_bit(statusRegister, STATUS_REGISTER_V_SHIFT, 0);
-            set_bit(statusRegister, STATUS_REGISTER_C_SHIFT, 0);
-            set_bit(statusRegister, STATUS_REGISTER_Z_SHIFT, result == 0);
-            set_bit(statusRegister, STATUS_REGISTER_N_SHIFT, result >> 63);
-        }
+        if constexpr (SET_STATUS)
+            defer_flags(setRegLo ? cpu_flag_operation::MULTIPLY_LONG : cpu_flag_operation::MULTIPLY, result >> ARM_WORD_BIT_LENGTH, result & 0xFFFFFFFF, 0, 0);
 
-        return 0;
+        // UMULL and UMLAL only stop early on leading zeroes, accumulating and the high word take a cycle each
+        constexpr bool isUnsignedLong = MULTIPLY_TYPE == 0b0100 || MULTIPLY_TYPE == 0b0101;
+        constexpr bool isAccumulate = MULTIPLY_TYPE & 0b1;
+        return get_multiply_cycles((u32)regS, !isUnsignedLong) + isAccumulate + setRegLo;
     }
 
+    template <bool IMMEDIATE, bool USE_SPSR, bool SET_PSR>
     const u32 cpu::arm_psr(const u32& _opcode)
     {
-        if (!check_condition(_opcode >> ARM_CONDITION_SHIFT))
-            return 0;
-
-        bool isImmediate = get_bit_bool(_opcode, 1 << 25);
-        bool useSPSR = get_bit_bool(_opcode, 1 << 22);
-        bool setPSR = get_bit_bool(_opcode, 1 << 21);
+        materialize_flags();
 
         bool isUserMode;
         u32& currentSPSR = get_current_spsr(isUserMode);
-        if (useSPSR && isUserMode)
+        if (USE_SPSR && isUserMode)
             return 0;
 
         u32& regD = get_register(_opcode & 0b1111);
         u32 operand = 0;
-        if (isImmediate)
+        if constexpr (IMMEDIATE)
         {
             u32 shift = ((_opcode >> 8) & 0b1111) * 2;
             operand = _opcode & 0xFF;
@@ -938,8 +1613,8 @@ namespace br::gba
             operand = regD;
         }
 
-        u32 tempPSR = useSPSR ? currentSPSR : statusRegister;
-        if (setPSR)
+        u32 tempPSR = USE_SPSR ? currentSPSR : statusRegister;
+        if constexpr (SET_PSR)
         {
             bool setFlags = get_bit_bool(_opcode, 1 << 19);
             bool setControl = get_bit_bool(_opcode, 1 << 16) && get_current_mode() != cpu_mode::USER;
@@ -949,7 +1624,10 @@ namespace br::gba
                     | ((STATUS_CONTROL_MASK & operand) * setControl)
                     | preserveMask;
             
-            (useSPSR ? currentSPSR : statusRegister) = tempPSR;
+            if constexpr (USE_SPSR)
+                currentSPSR = tempPSR;
+            else
+                set_status_register(tempPSR);
         }
         else
         {
@@ -978,40 +1656,40 @@ namespace br::gba
         u32 regD = (_opcode & 0b111) << 12;
 
         u32 opcode = conditionAlways | moveOp | setStatus | regD | offset | shiftOp | regS;
-        arm_dataproc(opcode);
-
-        return 0;
+        return arm_dataproc<0xD, false, false, true>(opcode);
     }
 
+    template <bool IMMEDIATE, bool SUBTRACT>
     const u32 cpu::thumb_data_reg(const u32& _opcode)
     {
         const u32 conditionAlways = 0xE << 28;
         const u32 setStatus = 1 << 20;
+        constexpr u32 dataOpcode = 4 >> SUBTRACT;
         
-        u32 isImmediate = (_opcode << 15) & (1 << 25);
-        u32 dataOp = (4 >> ((_opcode >> 9) & 0b1)) << 21;
+        u32 isImmediate = IMMEDIATE << 25;
+        u32 dataOp = dataOpcode << 21;
         u32 operand = (_opcode >> 6) & 0b111;
         u32 regS = (_opcode << 13) & (0b111 << 16);
         u32 regD = (_opcode & 0b111) << 12;
 
         u32 opcode = conditionAlways | isImmediate | dataOp | setStatus | regS | regD | operand;
-        arm_dataproc(opcode);
-
-        return 0;
+        return arm_dataproc<dataOpcode, IMMEDIATE, false, true>(opcode);
     }
 
+    template <u32 DATA_TYPE>
     const u32 cpu::thumb_data_imm(const u32& _opcode)
     {
         const u32 conditionAlways = 0xE << 28;
         const u32 isImmediate = 1 << 25;
         const u32 setStatus = 1 << 20;
 
-        bool isArithmetic = (_opcode >> 12) & 0b1;
-        bool isLogical = !isArithmetic;
-        u32 dataOpLo = (_opcode >> 11) & 0b1;
-        u32 arithmeticOp = 4 >> dataOpLo;
-        u32 logicalOp = bool_lerp(0xD, 0xA, dataOpLo);
-        u32 dataOp = bool_lerp(arithmeticOp, logicalOp, isLogical) << 21;
+        constexpr bool isArithmetic = (DATA_TYPE >> 1) & 0b1;
+        constexpr bool isLogical = !isArithmetic;
+        constexpr u32 dataOpLo = DATA_TYPE & 0b1;
+        constexpr u32 arithmeticOp = 4 >> dataOpLo;
+        constexpr u32 logicalOp = dataOpLo ? 0xA : 0xD;
+        constexpr u32 dataOpcode = isLogical ? logicalOp : arithmeticOp;
+        u32 dataOp = dataOpcode << 21;
         u32 regD = (_opcode << 4) & (0b111 << 12);
         u32 regD2 = regD << 4;
         u32 operand = _opcode & 0xFF;
@@ -1020,68 +1698,34 @@ namespace br::gba
         regD2 *= (isLogical && dataOpLo) || isArithmetic;
 
         u32 opcode = conditionAlways | isImmediate | dataOp | setStatus | regD2 | regD | operand;
-        arm_dataproc(opcode);
-
-        return 0;
+        return arm_dataproc<dataOpcode, true, false, true>(opcode);
     }
 
+    template <u32 ALU_TYPE>
     const u32 cpu::thumb_data_alu(const u32& _opcode)
     {
         const u32 conditionAlways = 0xE << 28;
         const u32 setStatus = 1 << 20;
 
-        u32 aluType = (_opcode >> 6) & 0b1111;
-        u32 dataOp = aluType;
-        u32 shiftOp = 0;
-        bool hasRegN = true;
-        bool isShift = false;
-        bool isNeg = false;
-        bool isMultiply = false;
-        switch (aluType)
-        {
-        case 0x2: // LSL
-            isShift = true;
-            shiftOp = 0;
-            dataOp = 0xD;
-            break;
-        case 0x3: // LSR
-            isShift = true;
-            shiftOp = 1;
-            dataOp = 0xD;
-            break;
-        case 0x4: // ASR
-            isShift = true;
-            shiftOp = 2;
-            dataOp = 0xD;
-            break;
-        case 0x7: // ROR
-            isShift = true;
-            shiftOp = 3;
-            dataOp = 0xD;
-            break;
-        case 0x9: // NEG
-            isNeg = true;
-            dataOp = 0x3;
-            break;
-        case 0xD: // MUL
-            isMultiply = true;
-            break;
-        case 0xF: // MVN
-            hasRegN = false;
-            break;
-        }
-
-        hasRegN = hasRegN && !isShift;
+        // LSL, LSR, ASR, ROR
+        constexpr bool isShift = ALU_TYPE == 0x2 || ALU_TYPE == 0x3 || ALU_TYPE == 0x4 || ALU_TYPE == 0x7;
+        constexpr bool isNeg = ALU_TYPE == 0x9;
+        constexpr bool isMultiply = ALU_TYPE == 0xD;
+        // MVN has no first operand
+        constexpr bool hasRegN = ALU_TYPE != 0xF && !isShift;
+        constexpr u32 shiftType = isShift ? (ALU_TYPE == 0x7 ? 3 : ALU_TYPE - 0x2) : 0;
+        constexpr u32 dataOpcode = isShift ? 0xD : (isNeg ? 0x3 : ALU_TYPE);
 
         u32 opcode = conditionAlways | setStatus;
-        if (isMultiply)
+        u32 cycleCount = 0;
+        if constexpr (isMultiply)
         {
             u32 regS = (_opcode << 5) & (0b111 << 8);
             u32 regD = (_opcode & 0b111) << 16;
             u32 regD2 = _opcode & 0b111;
 
             opcode |= regD | regS | regD2;
-            arm_multiply(opcode);
+            cycleCount = arm_multiply<0b0000, true>(opcode);
         }
         else
         {
@@ -1092,16 +1736,17 @@ namespace br::gba
             u32 regD = ((_opcode & 0b111) << 12);
             u32 regOperand = bool_lerp((_opcode >> 3) & 0b111, _opcode & 0b111, isShift) * !isNeg;
 
-            dataOp <<= 21;
-            shiftOp <<= 5;
+            u32 dataOp = dataOpcode << 21;
+            u32 shiftOp = shiftType << 5;
 
             opcode |= isImmediate | dataOp | regN | regD | regShift | shiftOp | isShiftByReg | regOperand;
-            arm_dataproc(opcode);
+            cycleCount = arm_dataproc<dataOpcode, isNeg, isShift, true>(opcode);
         }
 
-        return 0;
+        return cycleCount;
     }
 
+    template <u32 OPERATION_TYPE>
     const u32 cpu::thumb_data_hi(const u32& _opcode)
     {
         const u32 conditionAlways = 0xE << 28;
@@ -1109,37 +1754,21 @@ namespace br::gba
         u32 regS = ((_opcode >> 3) & 0b111) | ((_opcode >> 3) & 0b1000);
         u32 regD = (_opcode & 0b111) | ((_opcode >> 4) & 0b1000);
 
-        u32 opType = (_opcode >> 8) & 0b11;
-        u32 dataOp = 0;
-        bool isBranch = false;
-        bool isCMP = false;
-        bool isMOV = false;
-        switch (opType)
-        {
-        case 0x0: // ADD
-            dataOp = 0x4;
-            break;
-        case 0x1: // CMP + set status
-            dataOp = 0xA;
-            isCMP = true;
-            break;
-        case 0x2: // MOV / NOP
-            dataOp = 0xD;
-            isMOV = true;
-            break;
-        case 0x3: // BX
-            isBranch = true;
-            break;
-        }
+        // ADD, CMP + set status, MOV / NOP, BX
+        constexpr bool isBranch = OPERATION_TYPE == 0x3;
+        constexpr bool isCMP = OPERATION_TYPE == 0x1;
+        constexpr bool isMOV = OPERATION_TYPE == 0x2;
+        constexpr u32 dataOpcode = isCMP ? 0xA : (isMOV ? 0xD : 0x4);
 
-        if (isBranch)
+        u32 cycleCount = 0;
+        if constexpr (isBranch)
         {
             u32 regN = get_register(regS);
             bool armMode = regN & 0b1;
             
-            set_bit(statusRegister, STATUS_REGISTER_T_SHIFT, armMode);
+            set_thumb_state(armMode);
             
-            programCounter = regN;
+            registers[REGISTER_PROGRAM_COUNTER_INDEX] = regN;
         }
         else
         {
@@ -1147,13 +1776,13 @@ namespace br::gba
             u32 regN = (regD << 16) * !isMOV;
 
             u32 setStatus = isCMP << 20;
-            dataOp <<= 21;
+            u32 dataOp = dataOpcode << 21;
 
             u32 opcode = conditionAlways | dataOp | setStatus | regN | regD2 | regS;
-            arm_dataproc(opcode);
+            cycleCount = arm_dataproc<dataOpcode, false, false, isCMP>(opcode);
         }
 
-        return 0;
+        return cycleCount;
     }
 
     const u32 cpu::thumb_data_adr(const u32& _opcode)
@@ -1165,7 +1794,7 @@ namespace br::gba
         switch (dataType)
         {
         case 0: // ADD PC
-            regD = ((programCounter + ARM_WORD_LENGTH) & ~THUMB_WORD_LENGTH) + offset;
+            regD = ((registers[REGISTER_PROGRAM_COUNTER_INDEX] + ARM_WORD_LENGTH) & ~THUMB_WORD_LENGTH) + offset;
             break;
         case 1: // ADD SP
             regD = get_register(REGISTER_PROGRAM_COUNTER_INDEX) + offset;
@@ -1199,9 +1828,10 @@ namespace br::gba
         u32& regD = get_register((_opcode >> 8) & 0b111);
         u32 offset = (_opcode & 0xFF) * 4;
 
-        regD = addressBus.read_32(programCounter + offset);
+        u32 address = registers[REGISTER_PROGRAM_COUNTER_INDEX] + offset;
+        regD = addressBus.read_32(address);
 
-        return 0;
+        return get_data_cycles(address, sizeof(u32)) + 1;
     }
 
     const u32 cpu::thumb_trans_single(const u32& _opcode)
@@ -1228,7 +1858,10 @@ namespace br::gba
             break;
         }
 
-        return 0;
+        // odd transfer types are byte wide, the upper two are loads
+        bool isByte = transType & 0b1;
+        bool isLoad = transType >> 1;
+        return get_data_cycles(address, isByte ? sizeof(u8) : sizeof(u32)) + isLoad;
     }
 
     const u32 cpu::thumb_trans_extended(const u32& _opcode)
@@ -1257,7 +1890,10 @@ namespace br::gba
             break;
         }
 
-        return 0;
+        // everything but STRH is a load
+        bool isByte = transType == 1;
+        bool isLoad = transType != 0;
+        return get_data_cycles(address, isByte ? sizeof(u8) : sizeof(u16)) + isLoad;
     }
 
     const u32 cpu::thumb_trans_immediate(const u32& _opcode)
@@ -1284,7 +1920,10 @@ namespace br::gba
             break;
         }
 
-        return 0;
+        // the upper two types are byte wide, odd types are loads
+        bool isByte = transType >> 1;
+        bool isLoad = transType & 0b1;
+        return get_data_cycles(address, isByte ? sizeof(u8) : sizeof(u32)) + isLoad;
     }
 
     const u32 cpu::thumb_trans_half(const u32& _opcode)
@@ -1305,7 +1944,7 @@ namespace br::gba
             break;
         }
 
-        return 0;
+        return get_data_cycles(address, sizeof(u16)) + transType;
     }
 
     const u32 cpu::thumb_trans_stack(const u32& _opcode)
@@ -1326,42 +1965,39 @@ namespace br::gba
             break;
         }
 
-        return 0;
+        return get_data_cycles(address, sizeof(u32)) + transType;
     }
 
+    template <bool LOAD>
     const u32 cpu::thumb_trans_stackproc(const u32& _opcode)
     {
         const u32 writeBack = 1 << 21;
         const u32 regBase = REGISTER_STACK_POINTER_INDEX << 16;
 
-        bool isStore = (_opcode >> 11) & 0b1;
         bool hasExtraReg = (_opcode >> 8) & 0b1;
         
-        u32 prePost = !isStore << 24;
-        u32 upDown = isStore << 23;
-        u32 accessOp = isStore << 20;
-        u32 regExtra = (1 << bool_lerp(REGISTER_LINK_INDEX, REGISTER_PROGRAM_COUNTER_INDEX, isStore)) * hasExtraReg;
+        u32 prePost = !LOAD << 24;
+        u32 upDown = LOAD << 23;
+        u32 accessOp = LOAD << 20;
+        u32 regExtra = (1 << bool_lerp(REGISTER_LINK_INDEX, REGISTER_PROGRAM_COUNTER_INDEX, LOAD)) * hasExtraReg;
         u32 regList = (_opcode & 0xFF) | regExtra;
 
         u32 opcode = prePost | upDown | writeBack | accessOp | regBase | regList;
-        arm_trans_block(opcode);
-
-        return 0;
+        return arm_trans_block<!LOAD, LOAD, false, true, LOAD>(opcode);
     }
 
+    template <bool LOAD>
     const u32 cpu::thumb_trans_block(const u32& _opcode)
     {
         const u32 writeBack = 1 << 21;
         const u32 upDown = 1 << 23;
 
-        u32 accessOp = (_opcode << 9) & (1 << 20);
+        u32 accessOp = LOAD << 20;
         u32 regBase = (_opcode << 8) & (0b111 << 16);
         u32 regList = _opcode & 0xFF;
 
         u32 opcode = upDown | writeBack | accessOp | regBase | regList;
-        arm_trans_block(opcode);
-
-        return 0;
+        return arm_trans_block<false, true, false, true, LOAD>(opcode);
     }
 
     const u32 cpu::thumb_cond_branch(const u32& _opcode)
@@ -1369,7 +2005,7 @@ namespace br::gba
         bool condition = check_condition((_opcode >> 8) & 0xF);
 
         s32 offset = (s8)(_opcode & 0xFF) * 2;
-        programCounter = bool_lerp(programCounter, programCounter + offset, condition);
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] = bool_lerp(registers[REGISTER_PROGRAM_COUNTER_INDEX], registers[REGISTER_PROGRAM_COUNTER_INDEX] + offset, condition);
 
         return 0;
     }
@@ -1377,7 +2013,7 @@ namespace br::gba
     const u32 cpu::thumb_branch(const u32& _opcode)
     {
         s32 offset = (s32)((s16)((_opcode & 0x07FF) << 5)) >> 4;
-        programCounter += offset;
+        registers[REGISTER_PROGRAM_COUNTER_INDEX] += offset;
 
         return 0;
     }
@@ -1390,13 +2026,13 @@ namespace br::gba
         u32 address = _opcode & 0x7FF;
         if (isSecond)
         {
-            u32 tempPC = programCounter;
-            programCounter = regLink + (address << 1);
+            u32 tempPC = registers[REGISTER_PROGRAM_COUNTER_INDEX];
+            registers[REGISTER_PROGRAM_COUNTER_INDEX] = regLink + (address << 1);
             regLink = tempPC + THUMB_WORD_LENGTH;
         }
         else
         {
-            regLink = programCounter + THUMB_WORD_LENGTH + (address << 12);
+            regLink = registers[REGISTER_PROGRAM_COUNTER_INDEX] + THUMB_WORD_LENGTH + (address << 12);
         }
 
         return 0;
@@ -1409,57 +2045,219 @@ namespace br::gba
         return 0;
     }
 
+    cpu_handler cpu::specialize_arm_dataproc(const u32& _index)
+    {
+        // bit 25 immediate, bits 24-21 data opcode, bit 20 set status, bit 4 shift by register
+        static constexpr std::array<cpu_handler, 128> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            constexpr bool isImmediate = (variant >> 6) & 0b1;
+            constexpr bool shiftRegister = !isImmediate && (variant & 0b1);
+            return &cpu::arm_dataproc<(variant >> 2) & 0b1111, isImmediate, shiftRegister, ((variant >> 1) & 0b1) != 0>;
+        }, std::make_index_sequence<128>{});
+
+        return handlers[((_index >> 3) & 0b1111110) | (_index & 0b1)];
+    }
+
+    cpu_handler cpu::specialize_arm_branch(const u32& _index)
+    {
+        // bit 24 link
+        static constexpr std::array<cpu_handler, 2> handlers = { &cpu::arm_branch<false>, &cpu::arm_branch<true> };
+
+        return handlers[(_index >> 8) & 0b1];
+    }
+
+    cpu_handler cpu::specialize_arm_trans_single(const u32& _index)
+    {
+        // bit 25 register offset, bit 24 pre offset, bit 23 up, bit 22 byte, bit 21 write back, bit 20 load
+        static constexpr std::array<cpu_handler, 64> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            return &cpu::arm_trans_single<((variant >> 5) & 0b1) == 0, ((variant >> 4) & 0b1) != 0, ((variant >> 3) & 0b1) != 0,
+                ((variant >> 2) & 0b1) != 0, ((variant >> 1) & 0b1) != 0, (variant & 0b1) != 0>;
+        }, std::make_index_sequence<64>{});
+
+        return handlers[(_index >> 4) & 0b111111];
+    }
+
+    cpu_handler cpu::specialize_arm_trans_half(const u32& _index)
+    {
+        // bit 24 pre offset, bit 23 up, bit 22 immediate, bit 21 write back, bit 20 load
+        static constexpr std::array<cpu_handler, 32> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            return &cpu::arm_trans_half<((variant >> 4) & 0b1) != 0, ((variant >> 3) & 0b1) != 0, ((variant >> 2) & 0b1) != 0,
+                ((variant >> 1) & 0b1) != 0, (variant & 0b1) != 0>;
+        }, std::make_index_sequence<32>{});
+
+        return handlers[(_index >> 4) & 0b11111];
+    }
+
+    cpu_handler cpu::specialize_arm_trans_swap(const u32& _index)
+    {
+        // bit 22 byte
+        static constexpr std::array<cpu_handler, 2> handlers = { &cpu::arm_trans_swap<false>, &cpu::arm_trans_swap<true> };
+
+        return handlers[(_index >> 6) & 0b1];
+    }
+
+    cpu_handler cpu::specialize_arm_trans_block(const u32& _index)
+    {
+        // bit 24 pre offset, bit 23 up, bit 22 user mode, bit 21 write back, bit 20 load
+        static constexpr std::array<cpu_handler, 32> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            return &cpu::arm_trans_block<((variant >> 4) & 0b1) != 0, ((variant >> 3) & 0b1) != 0, ((variant >> 2) & 0b1) != 0,
+                ((variant >> 1) & 0b1) != 0, (variant & 0b1) != 0>;
+        }, std::make_index_sequence<32>{});
+
+        return handlers[(_index >> 4) & 0b11111];
+    }
+
+    cpu_handler cpu::specialize_arm_multiply(const u32& _index)
+    {
+        // bits 24-21 multiply type, bit 20 set status
+        static constexpr std::array<cpu_handler, 32> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            return &cpu::arm_multiply<(variant >> 1), (variant & 0b1) != 0>;
+        }, std::make_index_sequence<32>{});
+
+        return handlers[(_index >> 4) & 0b11111];
+    }
+
+    cpu_handler cpu::specialize_arm_psr(const u32& _index)
+    {
+        // bit 25 immediate, bit 22 spsr, bit 21 msr
+        static constexpr std::array<cpu_handler, 8> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            constexpr u32 variant = decltype(_variant)::value;
+            return &cpu::arm_psr<((variant >> 2) & 0b1) != 0, ((variant >> 1) & 0b1) != 0, (variant & 0b1) != 0>;
+        }, std::make_index_sequence<8>{});
+
+        return handlers[((_index >> 7) & 0b100) | ((_index >> 5) & 0b11)];
+    }
+
+    cpu_handler cpu::specialize_thumb_data_reg(const u32& _index)
+    {
+        // bit 10 immediate, bit 9 subtract
+        static constexpr std::array<cpu_handler, 4> handlers = 
+        {
+            &cpu::thumb_data_reg<false, false>, &cpu::thumb_data_reg<false, true>,
+            &cpu::thumb_data_reg<true, false>, &cpu::thumb_data_reg<true, true>
+        };
+
+        return handlers[(_index >> 3) & 0b11];
+    }
+
+    cpu_handler cpu::specialize_thumb_data_imm(const u32& _index)
+    {
+        // bits 12-11 operation
+        static constexpr std::array<cpu_handler, 4> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            return &cpu::thumb_data_imm<decltype(_variant)::value>;
+        }, std::make_index_sequence<4>{});
+
+        return handlers[(_index >> 5) & 0b11];
+    }
+
+    cpu_handler cpu::specialize_thumb_data_alu(const u32& _index)
+    {
+        // bits 9-6 alu operation
+        static constexpr std::array<cpu_handler, 16> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            return &cpu::thumb_data_alu<decltype(_variant)::value>;
+        }, std::make_index_sequence<16>{});
+
+        return handlers[_index & 0b1111];
+    }
+
+    cpu_handler cpu::specialize_thumb_data_hi(const u32& _index)
+    {
+        // bits 9-8 operation
+        static constexpr std::array<cpu_handler, 4> handlers = create_handler_array<cpu_handler>([](auto _variant)
+        {
+            return &cpu::thumb_data_hi<decltype(_variant)::value>;
+        }, std::make_index_sequence<4>{});
+
+        return handlers[(_index >> 2) & 0b11];
+    }
+
+    cpu_handler cpu::specialize_thumb_trans_stackproc(const u32& _index)
+    {
+        // bit 11 load
+        static constexpr std::array<cpu_handler, 2> handlers = { &cpu::thumb_trans_stackproc<false>, &cpu::thumb_trans_stackproc<true> };
+
+        return handlers[(_index >> 5) & 0b1];
+    }
+
+    cpu_handler cpu::specialize_thumb_trans_block(const u32& _index)
+    {
+        // bit 11 load
+        static constexpr std::array<cpu_handler, 2> handlers = { &cpu::thumb_trans_block<false>, &cpu::thumb_trans_block<true> };
+
+        return handlers[(_index >> 5) & 0b1];
+    }
+
+    template <cpu_handler H>
+    cpu_handler cpu::specialize_none(const u32& _index)
+    {
+        return H;
+    }
+
     void cpu::create_arm_isa()
     {
-        armISA[0] = { ARM_DATAPROC_1_MASK, ARM_DATAPROC_1_TEST, std::bind(&cpu::arm_dataproc, this, std::placeholders::_1),                     "ARM Data Proc 1" };
-        armISA[1] = { ARM_DATAPROC_2_MASK, ARM_DATAPROC_2_TEST, std::bind(&cpu::arm_dataproc, this, std::placeholders::_1),                     "ARM Data Proc 2" };
-        armISA[2] = { ARM_DATAPROC_3_MASK, ARM_DATAPROC_3_TEST, std::bind(&cpu::arm_dataproc, this, std::placeholders::_1),                     "ARM Data Proc 3" };
-        armISA[3] = { ARM_MULTIPLY_1_MASK, ARM_MULTIPLY_1_TEST, std::bind(&cpu::arm_multiply, this, std::placeholders::_1),                     "ARM Multiply 1" };
-        armISA[4] = { ARM_MULTIPLY_2_MASK, ARM_MULTIPLY_2_TEST, std::bind(&cpu::arm_multiply, this, std::placeholders::_1),                     "ARM Multiply 2" };
-        armISA[5] = { ARM_BRANCHING_1_MASK, ARM_BRANCHING_1_TEST, std::bind(&cpu::arm_branch_ex, this, std::placeholders::_1),                  "ARM Branch Ex" };
-        armISA[6] = { ARM_BRANCHING_2_MASK, ARM_BRANCHING_2_TEST, std::bind(&cpu::arm_branch, this, std::placeholders::_1),                     "ARM Branch" };
-        armISA[7] = { ARM_TRANSFER_1_MASK, ARM_TRANSFER_1_TEST, std::bind(&cpu::arm_trans_single, this, std::placeholders::_1),                 "ARM Transfer Single 1" };
-        armISA[8] = { ARM_TRANSFER_2_MASK, ARM_TRANSFER_2_TEST, std::bind(&cpu::arm_trans_single, this, std::placeholders::_1),                 "ARM Transfer Single 2" };
-        armISA[9] = { ARM_TRANSFER_3_MASK, ARM_TRANSFER_3_TEST, std::bind(&cpu::arm_trans_half, this, std::placeholders::_1),                   "ARM Transfer Half 1" };
-        armISA[10] = { ARM_TRANSFER_4_MASK, ARM_TRANSFER_4_TEST, std::bind(&cpu::arm_trans_half, this, std::placeholders::_1),                  "ARM Transfer Half 2" };
-        armISA[11] = { ARM_TRANSFER_5_MASK, ARM_TRANSFER_5_TEST, std::bind(&cpu::arm_trans_swap, this, std::placeholders::_1),                  "ARM Transfer Swap" };
-        armISA[12] = { ARM_TRANSFER_6_MASK, ARM_TRANSFER_6_TEST, std::bind(&cpu::arm_trans_block, this, std::placeholders::_1),                 "ARM Transfer Block" };
-        armISA[13] = { ARM_STATUSTRANS_1_MASK, ARM_STATUSTRANS_1_TEST, std::bind(&cpu::arm_psr, this, std::placeholders::_1),                   "ARM Status Transfer 1" };
-        armISA[14] = { ARM_STATUSTRANS_2_MASK, ARM_STATUSTRANS_2_TEST, std::bind(&cpu::arm_psr, this, std::placeholders::_1),                   "ARM Status Transfer 2" };
-        armISA[15] = { ARM_SOFTINTERRUPT_MASK, ARM_SOFTINTERRUPT_TEST, std::bind(&cpu::arm_soft_interrupt, this, std::placeholders::_1),        "ARM Software Interrupt" };
+        armISA[0] = { ARM_DATAPROC_1_MASK, ARM_DATAPROC_1_TEST, &cpu::specialize_arm_dataproc,                                  "ARM Data Proc 1" };
+        armISA[1] = { ARM_DATAPROC_2_MASK, ARM_DATAPROC_2_TEST, &cpu::specialize_arm_dataproc,                                  "ARM Data Proc 2" };
+        armISA[2] = { ARM_DATAPROC_3_MASK, ARM_DATAPROC_3_TEST, &cpu::specialize_arm_dataproc,                                  "ARM Data Proc 3" };
+        armISA[3] = { ARM_MULTIPLY_1_MASK, ARM_MULTIPLY_1_TEST, &cpu::specialize_arm_multiply,                                  "ARM Multiply 1" };
+        armISA[4] = { ARM_MULTIPLY_2_MASK, ARM_MULTIPLY_2_TEST, &cpu::specialize_arm_multiply,                                  "ARM Multiply 2" };
+        armISA[5] = { ARM_BRANCHING_1_MASK, ARM_BRANCHING_1_TEST, &cpu::specialize_none<&cpu::arm_branch_ex>,                   "ARM Branch Ex" };
+        armISA[6] = { ARM_BRANCHING_2_MASK, ARM_BRANCHING_2_TEST, &cpu::specialize_arm_branch,                                  "ARM Branch" };
+        armISA[7] = { ARM_TRANSFER_1_MASK, ARM_TRANSFER_1_TEST, &cpu::specialize_arm_trans_single,                              "ARM Transfer Single 1" };
+        armISA[8] = { ARM_TRANSFER_2_MASK, ARM_TRANSFER_2_TEST, &cpu::specialize_arm_trans_single,                              "ARM Transfer Single 2" };
+        armISA[9] = { ARM_TRANSFER_3_MASK, ARM_TRANSFER_3_TEST, &cpu::specialize_arm_trans_half,                                "ARM Transfer Half 1" };
+        armISA[10] = { ARM_TRANSFER_4_MASK, ARM_TRANSFER_4_TEST, &cpu::specialize_arm_trans_half,                               "ARM Transfer Half 2" };
+        armISA[11] = { ARM_TRANSFER_5_MASK, ARM_TRANSFER_5_TEST, &cpu::specialize_arm_trans_swap,                               "ARM Transfer Swap" };
+        armISA[12] = { ARM_TRANSFER_6_MASK, ARM_TRANSFER_6_TEST, &cpu::specialize_arm_trans_block,                              "ARM Transfer Block" };
+        armISA[13] = { ARM_STATUSTRANS_1_MASK, ARM_STATUSTRANS_1_TEST, &cpu::specialize_arm_psr,                                "ARM Status Transfer 1" };
+        armISA[14] = { ARM_STATUSTRANS_2_MASK, ARM_STATUSTRANS_2_TEST, &cpu::specialize_arm_psr,                                "ARM Status Transfer 2" };
+        armISA[15] = { ARM_SOFTINTERRUPT_MASK, ARM_SOFTINTERRUPT_TEST, &cpu::specialize_none<&cpu::arm_soft_interrupt>,         "ARM Software Interrupt" };
 
         sort_isa_array<cpu_instruction, ARM_ISA_COUNT, ARM_WORD_BIT_LENGTH>(armISA);
+        create_decode_table<cpu_instruction, cpu_handler, ARM_ISA_COUNT, ARM_DECODE_TABLE_SIZE>(armISA, armDecodeTable, armHandlerTable, ARM_DECODE_INDEX_MASK, &arm_decode_opcode);
     }
 
     void cpu::create_thumb_isa()
     {
-        thumbISA[0] = { THUMB_SHIFT_MASK, THUMB_SHIFT_TEST, std::bind(&cpu::thumb_shift, this, std::placeholders::_1),                                  "THUMB Shift" };
-        thumbISA[1] = { THUMB_DATA_REG_MASK, THUMB_DATA_REG_TEST, std::bind(&cpu::thumb_data_reg, this, std::placeholders::_1),                         "THUMB Data Proc Reg (ADD/SUB)" };
-        thumbISA[2] = { THUMB_DATA_IMM_MASK, THUMB_DATA_IMM_TEST, std::bind(&cpu::thumb_data_imm, this, std::placeholders::_1),                         "THUMB Data Proc Imm (ADD/SUB/TEST)" };
-        thumbISA[3] = { THUMB_DATA_ALU_MASK, THUMB_DATA_ALU_TEST, std::bind(&cpu::thumb_data_alu, this, std::placeholders::_1),                         "THUMB Data Proc ALU" };
-        thumbISA[4] = { THUMB_DATA_HI_MASK, THUMB_DATA_HI_TEST, std::bind(&cpu::thumb_data_hi, this, std::placeholders::_1),                            "THUMB Data Proc HI" };
-        thumbISA[5] = { THUMB_DATA_ADR_MASK, THUMB_DATA_ADR_TEST, std::bind(&cpu::thumb_data_adr, this, std::placeholders::_1),                         "THUMB Data Proc Address" };
-        thumbISA[6] = { THUMB_DATA_STACK_MASK, THUMB_DATA_STACK_TEST, std::bind(&cpu::thumb_data_stack, this, std::placeholders::_1),                   "THUMB Data Proc Stack" };
-        thumbISA[7] = { THUMB_TRANS_RELATIVE_MASK, THUMB_TRANS_RELATIVE_TEST, std::bind(&cpu::thumb_trans_relative, this, std::placeholders::_1),       "THUMB Transfer PC Relative" };
-        thumbISA[8] = { THUMB_TRANS_SINGLE_MASK, THUMB_TRANS_SINGLE_TEST, std::bind(&cpu::thumb_trans_single, this, std::placeholders::_1),             "THUMB Transfer Single" };
-        thumbISA[9] = { THUMB_TRANS_EXTENDED_MASK, THUMB_TRANS_EXTENDED_TEST, std::bind(&cpu::thumb_trans_extended, this, std::placeholders::_1),       "THUMB Transfer Extended" };
-        thumbISA[10] = { THUMB_TRANS_IMM_MASK, THUMB_TRANS_IMM_TEST, std::bind(&cpu::thumb_trans_immediate, this, std::placeholders::_1),               "THUMB Transfer Immediate" };
-        thumbISA[11] = { THUMB_TRANS_HALF_MASK, THUMB_TRANS_HALF_TEST, std::bind(&cpu::thumb_trans_half, this, std::placeholders::_1),                  "THUMB Transfer Half" };
-        thumbISA[12] = { THUMB_TRANS_STACK_MASK, THUMB_TRANS_STACK_TEST, std::bind(&cpu::thumb_trans_stack, this, std::placeholders::_1),               "THUMB Transfer Stack" };
-        thumbISA[13] = { THUMB_TRANS_STACKPROC_MASK, THUMB_TRANS_STACKPROC_TEST, std::bind(&cpu::thumb_trans_stackproc, this, std::placeholders::_1),   "THUMB Transfer Stack Proc" };
-        thumbISA[14] = { THUMB_TRANS_BLOCK_MASK, THUMB_TRANS_BLOCK_TEST, std::bind(&cpu::thumb_trans_block, this, std::placeholders::_1),               "THUMB Transfer Block" };
-        thumbISA[15] = { THUMB_COND_BRANCH_MASK, THUMB_COND_BRANCH_TEST, std::bind(&cpu::thumb_cond_branch, this, std::placeholders::_1),               "THUMB Conditional Branch" };
-        thumbISA[16] = { THUMB_BRANCH_MASK, THUMB_BRANCH_TEST, std::bind(&cpu::thumb_branch, this, std::placeholders::_1),                              "THUMB Branch" };
-        thumbISA[17] = { THUMB_BRANCH_LINK_MASK, THUMB_BRANCH_LINK_TEST, std::bind(&cpu::thumb_branch_link, this, std::placeholders::_1),               "THUMB Branch With Link" };
-        thumbISA[18] = { THUMB_SOFTINTERRUPT_MASK, THUMB_SOFTINTERRUPT_TEST, std::bind(&cpu::thumb_soft_interrupt, this, std::placeholders::_1),        "THUMB Software Interrupt" };
+        thumbISA[0] = { THUMB_SHIFT_MASK, THUMB_SHIFT_TEST, &cpu::specialize_none<&cpu::thumb_shift>,                                   "THUMB Shift" };
+        thumbISA[1] = { THUMB_DATA_REG_MASK, THUMB_DATA_REG_TEST, &cpu::specialize_thumb_data_reg,                                      "THUMB Data Proc Reg (ADD/SUB)" };
+        thumbISA[2] = { THUMB_DATA_IMM_MASK, THUMB_DATA_IMM_TEST, &cpu::specialize_thumb_data_imm,                                      "THUMB Data Proc Imm (ADD/SUB/TEST)" };
+        thumbISA[3] = { THUMB_DATA_ALU_MASK, THUMB_DATA_ALU_TEST, &cpu::specialize_thumb_data_alu,                                      "THUMB Data Proc ALU" };
+        thumbISA[4] = { THUMB_DATA_HI_MASK, THUMB_DATA_HI_TEST, &cpu::specialize_thumb_data_hi,                                         "THUMB Data Proc HI" };
+        thumbISA[5] = { THUMB_DATA_ADR_MASK, THUMB_DATA_ADR_TEST, &cpu::specialize_none<&cpu::thumb_data_adr>,                          "THUMB Data Proc Address" };
+        thumbISA[6] = { THUMB_DATA_STACK_MASK, THUMB_DATA_STACK_TEST, &cpu::specialize_none<&cpu::thumb_data_stack>,                    "THUMB Data Proc Stack" };
+        thumbISA[7] = { THUMB_TRANS_RELATIVE_MASK, THUMB_TRANS_RELATIVE_TEST, &cpu::specialize_none<&cpu::thumb_trans_relative>,        "THUMB Transfer PC Relative" };
+        thumbISA[8] = { THUMB_TRANS_SINGLE_MASK, THUMB_TRANS_SINGLE_TEST, &cpu::specialize_none<&cpu::thumb_trans_single>,              "THUMB Transfer Single" };
+        thumbISA[9] = { THUMB_TRANS_EXTENDED_MASK, THUMB_TRANS_EXTENDED_TEST, &cpu::specialize_none<&cpu::thumb_trans_extended>,        "THUMB Transfer Extended" };
+        thumbISA[10] = { THUMB_TRANS_IMM_MASK, THUMB_TRANS_IMM_TEST, &cpu::specialize_none<&cpu::thumb_trans_immediate>,                "THUMB Transfer Immediate" };
+        thumbISA[11] = { THUMB_TRANS_HALF_MASK, THUMB_TRANS_HALF_TEST, &cpu::specialize_none<&cpu::thumb_trans_half>,                   "THUMB Transfer Half" };
+        thumbISA[12] = { THUMB_TRANS_STACK_MASK, THUMB_TRANS_STACK_TEST, &cpu::specialize_none<&cpu::thumb_trans_stack>,                "THUMB Transfer Stack" };
+        thumbISA[13] = { THUMB_TRANS_STACKPROC_MASK, THUMB_TRANS_STACKPROC_TEST, &cpu::specialize_thumb_trans_stackproc,                "THUMB Transfer Stack Proc" };
+        thumbISA[14] = { THUMB_TRANS_BLOCK_MASK, THUMB_TRANS_BLOCK_TEST, &cpu::specialize_thumb_trans_block,                            "THUMB Transfer Block" };
+        thumbISA[15] = { THUMB_COND_BRANCH_MASK, THUMB_COND_BRANCH_TEST, &cpu::specialize_none<&cpu::thumb_cond_branch>,                "THUMB Conditional Branch" };
+        thumbISA[16] = { THUMB_BRANCH_MASK, THUMB_BRANCH_TEST, &cpu::specialize_none<&cpu::thumb_branch>,                               "THUMB Branch" };
+        thumbISA[17] = { THUMB_BRANCH_LINK_MASK, THUMB_BRANCH_LINK_TEST, &cpu::specialize_none<&cpu::thumb_branch_link>,                "THUMB Branch With Link" };
+        thumbISA[18] = { THUMB_SOFTINTERRUPT_MASK, THUMB_SOFTINTERRUPT_TEST, &cpu::specialize_none<&cpu::thumb_soft_interrupt>,         "THUMB Software Interrupt" };
 
         sort_isa_array<cpu_instruction, THUMB_ISA_COUNT, THUMB_WORD_BIT_LENGTH>(thumbISA);
+        create_decode_table<cpu_instruction, cpu_handler, THUMB_ISA_COUNT, THUMB_DECODE_TABLE_SIZE>(thumbISA, thumbDecodeTable, thumbHandlerTable, THUMB_DECODE_INDEX_MASK, &thumb_decode_opcode);
     }
 
     void cpu::reset_registers()
     {
-        for (u32 i = 0; i < 8; ++i)
-            thumbRegisters[i] = 0;
+        for (u32 i = 0; i < REGISTER_LIST_LENGTH; ++i)
+            registers[i] = 0;
 
         for (u32 i = 0; i < 10; ++i)
             armRegisters[i] = 0;
@@ -1474,11 +2272,18 @@ namespace br::gba
             savedStatusRegisters[i] = 0;
 
         statusRegister = 0;
-        programCounter = 0;
+        flagOperation = cpu_flag_operation::NONE;
+        flagResult = 0;
+        flagOperandA = 0;
+        flagOperandB = 0;
+        flagCarry = 0;
     }
 
     cpu::cpu(bus& _addressBus)
-        : addressBus{ _addressBus }
+        : backend{ cpu_backend::CACHED }, currentCodePage{ nullptr }, currentCodePageKey{ CODE_CACHE_EMPTY }, blockRecompiler{ *this, _addressBus },
+          runBudget{ 0 }, runLimit{ 0 }, runCycles{ 0 }, runInstructions{ 0 }, halted{ false }, irqLine{ false }, irqPending{ false },
+          idleDetection{ true }, idle{ false }, idleLoop{ nullptr }, idleLoopKey{ CODE_CACHE_EMPTY }, idleReadCount{ 0 }, addressBus{ _addressBus },
+          traceLevel{ cpu_trace_level::OFF }, traceHead{ 0 }, traceCount{ 0 }
     {
         reset_registers();
         create_arm_isa();
@@ -0,0 +1,123 @@
+#include "../include/display.h"
+#include "../include/bus.h"
+#include "../include/scheduler.h"
+#include "../include/interrupt_controller.h"
+
+namespace br::gba
+{
+    void display::reset()
+    {
+        line = 0;
+        frameTimestamp = systemScheduler.get_timestamp();
+        frameCount = 0;
+        update_line_registers();
+
+        systemScheduler.schedule(hblankEvent, frameTimestamp + DISPLAY_HDRAW_CYCLES);
+        systemScheduler.schedule(lineEvent, frameTimestamp + DISPLAY_LINE_CYCLES);
+    }
+
+    void display::restore()
+    {
+        line = addressBus.get_io_register(IO_VCOUNT_ADDR) % DISPLAY_LINE_COUNT;
+        bool isHBlank = addressBus.get_io_register(IO_DISPSTAT_ADDR) & DISPSTAT_HBLANK;
+
+        // timestamps only get added to, so the line may start before timestamp 0
+        u64 lineTimestamp = systemScheduler.get_timestamp() - (isHBlank ? DISPLAY_HDRAW_CYCLES : 0);
+        frameTimestamp = lineTimestamp - line * DISPLAY_LINE_CYCLES;
+        update_line_registers();
+        if (isHBlank)
+            addressBus.set_io_register(IO_DISPSTAT_ADDR, addressBus.get_io_register(IO_DISPSTAT_ADDR) | DISPSTAT_HBLANK);
+
+        systemScheduler.schedule(hblankEvent, lineTimestamp + DISPLAY_HDRAW_CYCLES + (isHBlank ? DISPLAY_LINE_CYCLES : 0));
+        systemScheduler.schedule(lineEvent, lineTimestamp + DISPLAY_LINE_CYCLES);
+    }
+
+    const u64 display::get_next_vblank()
+    {
+        u64 vblankTimestamp = frameTimestamp + DISPLAY_VISIBLE_LINES * DISPLAY_LINE_CYCLES;
+        return line < DISPLAY_VISIBLE_LINES ? vblankTimestamp : vblankTimestamp + DISPLAY_FRAME_CYCLES;
+    }
+
+    const u64 display::get_frame_count()
+    {
+        return frameCount;
+    }
+
+    const u32 display::get_line()
+    {
+        return line;
+    }
+
+    const u16 display::get_interrupt_sources()
+    {
+        u16 status = addressBus.get_io_register(IO_DISPSTAT_ADDR);
+        return ((status & DISPSTAT_VBLANK_IRQ) ? IRQ_VBLANK : 0) | ((status & DISPSTAT_HBLANK_IRQ) ? IRQ_HBLANK : 0)
+            | ((status & DISPSTAT_VCOUNT_IRQ) ? IRQ_VCOUNT : 0);
+    }
+
+    void display::start_hblank(const u64& _timestamp)
+    {
+        u16 status = addressBus.get_io_register(IO_DISPSTAT_ADDR) | DISPSTAT_HBLANK;
+        addressBus.set_io_register(IO_DISPSTAT_ADDR, status);
+        if (status & DISPSTAT_HBLANK_IRQ)
+            systemInterrupts.request(IRQ_HBLANK);
+
+        systemScheduler.schedule(hblankEvent, _timestamp + DISPLAY_LINE_CYCLES);
+    }
+
+    void display::end_line(const u64& _timestamp)
+    {
+        if (++line == DISPLAY_LINE_COUNT)
+        {
+            line = 0;
+            frameTimestamp = _timestamp;
+            ++frameCount;
+        }
+
+        update_line_registers();
+
+        u16 status = addressBus.get_io_register(IO_DISPSTAT_ADDR);
+        u16 interrupts = (line == DISPLAY_VISIBLE_LINES && (status & DISPSTAT_VBLANK_IRQ) ? IRQ_VBLANK : 0)
+            | ((status & DISPSTAT_VCOUNT) && (status & DISPSTAT_VCOUNT_IRQ) ? IRQ_VCOUNT : 0);
+        if (interrupts)
+            systemInterrupts.request(interrupts);
+
+        systemScheduler.schedule(lineEvent, _timestamp + DISPLAY_LINE_CYCLES);
+    }
+
+    void display::update_line_registers()
+    {
+        u16 status = addressBus.get_io_register(IO_DISPSTAT_ADDR) & ~DISPSTAT_FLAGS_MASK;
+        bool isVBlank = line >= DISPLAY_VISIBLE_LINES && line != DISPLAY_LINE_COUNT - 1;
+        bool isVCount = (status >> DISPSTAT_VCOUNT_SHIFT) == line;
+        status |= (isVBlank ? DISPSTAT_VBLANK : 0) | (isVCount ? DISPSTAT_VCOUNT : 0);
+
+        addressBus.set_io_register(IO_DISPSTAT_ADDR, status);
+        addressBus.set_io_register(IO_VCOUNT_ADDR, line);
+    }
+
+    const u16 display::write_status(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        // the flags are read only
+        u16 writeMask = _mask & ~DISPSTAT_FLAGS_MASK;
+        u16 status = (_previous & ~writeMask) | (_data & writeMask);
+
+        bool isVCount = (status >> DISPSTAT_VCOUNT_SHIFT) == line;
+        return (status & ~DISPSTAT_VCOUNT) | (isVCount ? DISPSTAT_VCOUNT : 0);
+    }
+
+    const u16 display::write_line(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        return _previous;
+    }
+
+    display::display(bus& _addressBus, scheduler& _systemScheduler, interrupt_controller& _systemInterrupts)
+        : addressBus{ _addressBus }, systemScheduler{ _systemScheduler }, systemInterrupts{ _systemInterrupts }, line{ 0 }, frameTimestamp{ 0 }, frameCount{ 0 }
+    {
+        hblankEvent = systemScheduler.add_event(std::bind(&display::start_hblank, this, std::placeholders::_1));
+        lineEvent = systemScheduler.add_event(std::bind(&display::end_line, this, std::placeholders::_1));
+
+        addressBus.set_io_handler(IO_DISPSTAT_ADDR, nullptr, std::bind(&display::write_status, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        addressBus.set_io_handler(IO_VCOUNT_ADDR, nullptr, std::bind(&display::write_line, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    }
+}
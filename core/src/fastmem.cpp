@@ -0,0 +1,146 @@
+#include "../include/fastmem.h"
+#include "../include/bus_constants.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace br::gba
+{
+#ifdef __linux__
+    const bool fastmem::create(const u32& _memorySize)
+    {
+        destroy();
+
+        memoryFile = memfd_create("brgba_memory", MFD_CLOEXEC);
+        if (memoryFile < 0)
+            return false;
+
+        if (ftruncate(memoryFile, _memorySize) != 0)
+        {
+            destroy();
+            return false;
+        }
+        memorySize = _memorySize;
+
+        void* mappedMemory = mmap(nullptr, _memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, memoryFile, 0);
+        if (mappedMemory == MAP_FAILED)
+        {
+            destroy();
+            return false;
+        }
+        memory = static_cast<u8*>(mappedMemory);
+
+        // private anonymous pages read as zero and are never committed
+        void* mappedView = mmap(nullptr, FASTMEM_VIEW_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mappedView == MAP_FAILED)
+        {
+            destroy();
+            return false;
+        }
+        view = static_cast<u8*>(mappedView);
+
+        return true;
+    }
+
+    void fastmem::destroy()
+    {
+        if (view != nullptr)
+            munmap(view, FASTMEM_VIEW_SIZE);
+        if (memory != nullptr)
+            munmap(memory, memorySize);
+        if (memoryFile >= 0)
+            close(memoryFile);
+
+        memoryFile = -1;
+        memorySize = 0;
+        memory = nullptr;
+        view = nullptr;
+    }
+
+    const bool fastmem::map_memory(const u32& _offset, const u32& _size, const u32& _address, const u32& _areaSize)
+    {
+        if (view == nullptr)
+            return false;
+
+        for (u32 offset = 0; offset < _areaSize; offset += _size)
+        {
+            void* mirror = mmap(view + _address + offset, _size, PROT_READ, MAP_SHARED | MAP_FIXED, memoryFile, _offset);
+            if (mirror == MAP_FAILED)
+                return false;
+        }
+
+        return true;
+    }
+
+    const bool fastmem::map_file(const int& _file, const u32& _fileSize, const u32& _size, const u32& _address, const u32& _areaSize)
+    {
+        if (view == nullptr || !clear_area(_address, _areaSize))
+            return false;
+
+        // the tail of the last host page reads as zero, pages past it stay cleared
+        for (u32 offset = 0; offset < _areaSize; offset += _size)
+        {
+            void* mirror = mmap(view + _address + offset, _fileSize, PROT_READ, MAP_SHARED | MAP_FIXED, _file, 0);
+            if (mirror == MAP_FAILED)
+                return false;
+        }
+
+        return true;
+    }
+
+    const bool fastmem::clear_area(const u32& _address, const u32& _areaSize)
+    {
+        if (view == nullptr)
+            return false;
+
+        void* cleared = mmap(view + _address, _areaSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        return cleared != MAP_FAILED;
+    }
+#else
+    const bool fastmem::create(const u32& _memorySize)
+    {
+        return false;
+    }
+
+    void fastmem::destroy()
+    {
+    }
+
+    const bool fastmem::map_memory(const u32& _offset, const u32& _size, const u32& _address, const u32& _areaSize)
+    {
+        return false;
+    }
+
+    const bool fastmem::map_file(const int& _file, const u32& _fileSize, const u32& _size, const u32& _address, const u32& _areaSize)
+    {
+        return false;
+    }
+
+    const bool fastmem::clear_area(const u32& _address, const u32& _areaSize)
+    {
+        return false;
+    }
+#endif
+
+    u8* fastmem::get_memory()
+    {
+        return memory;
+    }
+
+    u8* fastmem::get_base()
+    {
+        return view;
+    }
+
+    fastmem::fastmem()
+        : memoryFile{ -1 }, memorySize{ 0 }, memory{ nullptr }, view{ nullptr }
+    {
+    }
+
+    fastmem::~fastmem()
+    {
+        destroy();
+    }
+}
\ No newline at end of file
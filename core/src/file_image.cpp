@@ -0,0 +1,133 @@
+#include "../include/file_image.h"
+#include "../include/bus_constants.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace br::gba
+{
+#ifdef __linux__
+    const bool file_image::open(const std::string& _filePath, const u32& _maxSize)
+    {
+        close();
+
+        int openedFile = ::open(_filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (openedFile < 0)
+            return false;
+
+        struct stat fileStatus;
+        if (fstat(openedFile, &fileStatus) != 0 || fileStatus.st_size == 0 || fileStatus.st_size > _maxSize)
+        {
+            ::close(openedFile);
+            return false;
+        }
+
+        // pad to whole bus and host pages, the padding is zero filled anonymous memory
+        u32 pageSize = std::max<u32>(MEMORY_PAGE_SIZE, sysconf(_SC_PAGESIZE));
+        u32 paddedSize = (fileStatus.st_size + pageSize - 1) & ~(pageSize - 1);
+
+        void* reserved = mmap(nullptr, paddedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            ::close(openedFile);
+            return false;
+        }
+
+        if (mmap(reserved, fileStatus.st_size, PROT_READ, MAP_SHARED | MAP_FIXED, openedFile, 0) == MAP_FAILED)
+        {
+            munmap(reserved, paddedSize);
+            ::close(openedFile);
+            return false;
+        }
+
+        file = openedFile;
+        fileSize = fileStatus.st_size;
+        size = paddedSize;
+        memory = static_cast<u8*>(reserved);
+
+        return true;
+    }
+
+    void file_image::close()
+    {
+        if (memory != nullptr)
+            munmap(memory, size);
+        if (file >= 0)
+            ::close(file);
+
+        file = -1;
+        fileSize = 0;
+        size = 0;
+        memory = nullptr;
+    }
+#else
+    const bool file_image::open(const std::string& _filePath, const u32& _maxSize)
+    {
+        close();
+
+        std::ifstream openedFile(_filePath, std::ios::binary | std::ios::ate);
+        if (!openedFile.good())
+            return false;
+
+        std::streampos openedSize = openedFile.tellg();
+        if (openedSize <= 0 || openedSize > _maxSize)
+            return false;
+
+        openedFile.seekg(0, std::ios::beg);
+        fileData.resize((static_cast<u32>(openedSize) + MEMORY_PAGE_MASK) & ~MEMORY_PAGE_MASK, 0);
+        openedFile.read(reinterpret_cast<char*>(fileData.data()), openedSize);
+
+        fileSize = openedSize;
+        size = fileData.size();
+        memory = fileData.data();
+
+        return true;
+    }
+
+    void file_image::close()
+    {
+        std::vector<u8>().swap(fileData);
+
+        fileSize = 0;
+        size = 0;
+        memory = nullptr;
+    }
+#endif
+
+    u8* file_image::get_memory()
+    {
+        return memory;
+    }
+
+    const u32 file_image::get_size()
+    {
+        return size;
+    }
+
+    const u32 file_image::get_file_size()
+    {
+        return fileSize;
+    }
+
+    const int file_image::get_file()
+    {
+        return file;
+    }
+
+    file_image::file_image()
+        : file{ -1 }, fileSize{ 0 }, size{ 0 }, memory{ nullptr }
+    {
+    }
+
+    file_image::~file_image()
+    {
+        close();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "../include/gba.h"
+#include <algorithm>
+
+namespace br::gba
+{
+    const bool gba::load_bios(const std::string& _filePath)
+    {
+        return systemBus.load_bios(_filePath);
+    }
+
+    const bool gba::load_rom(const std::string& _filePath)
+    {
+        return systemBus.load_rom(_filePath);
+    }
+
+    void gba::reset()
+    {
+        systemScheduler.reset();
+        systemInterrupts.reset();
+        systemDisplay.reset();
+        systemTimers.reset();
+        systemCPU.resume();
+        systemCPU.reset();
+    }
+
+    const u64 gba::run_until(const u64& _timestamp)
+    {
+        u64 instructions = 0;
+        systemScheduler.run_events();
+        while (systemScheduler.get_timestamp() < _timestamp)
+            step<false>(_timestamp, instructions);
+
+        return systemScheduler.get_timestamp();
+    }
+
+    const u64 gba::run_frame()
+    {
+        return run_until(systemDisplay.get_next_vblank());
+    }
+
+    const u64 gba::run_instructions(const u64& _count)
+    {
+        u64 instructions = _count;
+        systemScheduler.run_events();
+        while (instructions > 0 && (!systemCPU.is_halted() || can_wake()))
+            step<true>(SCHEDULER_NEVER, instructions);
+
+        return systemScheduler.get_timestamp();
+    }
+
+    void gba::save_memory_state(std::vector<u8>& _state)
+    {
+        systemBus.save_memory_state(_state);
+    }
+
+    const bool gba::load_memory_state(const std::vector<u8>& _state)
+    {
+        if (!systemBus.load_memory_state(_state))
+            return false;
+
+        systemDisplay.restore();
+        systemTimers.restore();
+        systemInterrupts.update();
+        return true;
+    }
+
+    const u64 gba::get_timestamp()
+    {
+        return systemScheduler.get_timestamp();
+    }
+
+    void gba::set_idle_skip(const bool& _enabled)
+    {
+        systemCPU.set_idle_detection(_enabled);
+    }
+
+    const bool gba::get_idle_skip()
+    {
+        return systemCPU.get_idle_detection();
+    }
+
+    bus& gba::get_bus()
+    {
+        return systemBus;
+    }
+
+    cpu& gba::get_cpu()
+    {
+        return systemCPU;
+    }
+
+    scheduler& gba::get_scheduler()
+    {
+        return systemScheduler;
+    }
+
+    interrupt_controller& gba::get_interrupts()
+    {
+        return systemInterrupts;
+    }
+
+    display& gba::get_display()
+    {
+        return systemDisplay;
+    }
+
+    timers& gba::get_timers()
+    {
+        return systemTimers;
+    }
+
+    const u32 gba::get_cycle_budget(const u64& _timestamp)
+    {
+        // the last instruction of a run can overshoot the stop, which leaves nothing to skip
+        u64 stopTimestamp = std::min(_timestamp, systemScheduler.get_next_timestamp());
+        u64 cycles = stopTimestamp > systemScheduler.get_timestamp() ? stopTimestamp - systemScheduler.get_timestamp() : 0;
+        return (u32)std::min<u64>(cycles, ~0u);
+    }
+
+    const bool gba::can_wake()
+    {
+        u16 sources = systemDisplay.get_interrupt_sources() | systemTimers.get_interrupt_sources();
+        return (systemBus.get_io_register(IO_IE_ADDR) & (sources | systemBus.get_io_register(IO_IF_ADDR))) != 0;
+    }
+
+    template <bool COUNT_INSTRUCTIONS>
+    void gba::step(const u64& _timestamp, u64& _instructions)
+    {
+        if (!systemCPU.is_halted())
+        {
+            u32 cycles = COUNT_INSTRUCTIONS ? systemCPU.run(get_cycle_budget(_timestamp), _instructions) : systemCPU.run(get_cycle_budget(_timestamp));
+            systemScheduler.advance(cycles);
+        }
+
+        // nothing the cpu waits for changes before the next event
+        if (systemCPU.is_halted() || systemCPU.is_idle())
+            systemScheduler.advance(get_cycle_budget(_timestamp));
+
+        systemScheduler.run_events();
+    }
+
+    const u16 gba::write_power_control(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        // bit 7 of HALTCNT selects stop mode, which is left like a halt as nothing is powered down
+        // a requested interrupt ends the halt right away, the controller resumes the cpu on later requests
+        if ((_mask & IO_HALTCNT_MASK) && !systemInterrupts.is_requested())
+            systemCPU.halt();
+
+        // HALTCNT is write only
+        return (_previous & ~_mask) | (_data & ~IO_HALTCNT_MASK);
+    }
+
+    gba::gba()
+        : systemCPU{ systemBus }, systemInterrupts{ systemBus, systemCPU }, systemDisplay{ systemBus, systemScheduler, systemInterrupts },
+          systemTimers{ systemBus, systemScheduler, systemCPU, systemInterrupts }
+    {
+        systemBus.set_io_handler(IO_POSTFLG_ADDR, nullptr, std::bind(&gba::write_power_control, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        reset();
+    }
+}
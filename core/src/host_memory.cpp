@@ -0,0 +1,75 @@
+#include "../include/host_memory.h"
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace br::gba
+{
+#ifdef __linux__
+    void* allocate_host_memory(const std::size_t& _size, const bool& _hugePages)
+    {
+        // anonymous pages are demand zeroed
+        if (!_hugePages)
+        {
+            void* memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return memory != MAP_FAILED ? memory : nullptr;
+        }
+
+        // over allocate by a huge page and trim both ends so the memory starts on a huge page boundary
+        std::size_t alignedSize = (_size + HOST_HUGE_PAGE_SIZE - 1) & ~(HOST_HUGE_PAGE_SIZE - 1);
+        void* reserved = mmap(nullptr, alignedSize + HOST_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+            return nullptr;
+
+        u8* reservedStart = static_cast<u8*>(reserved);
+        u8* memory = reinterpret_cast<u8*>((reinterpret_cast<std::uintptr_t>(reservedStart) + HOST_HUGE_PAGE_SIZE - 1) & ~(HOST_HUGE_PAGE_SIZE - 1));
+        if (memory != reservedStart)
+            munmap(reservedStart, memory - reservedStart);
+        munmap(memory + alignedSize, reservedStart + HOST_HUGE_PAGE_SIZE - memory);
+
+        // only advice, without transparent huge pages the memory stays on normal pages
+        madvise(memory, alignedSize, MADV_HUGEPAGE);
+        return memory;
+    }
+
+    void free_host_memory(void* _memory, const std::size_t& _size, const bool& _hugePages)
+    {
+        std::size_t alignedSize = _hugePages ? (_size + HOST_HUGE_PAGE_SIZE - 1) & ~(HOST_HUGE_PAGE_SIZE - 1) : _size;
+        munmap(_memory, alignedSize);
+    }
+
+    void* allocate_executable_memory(const std::size_t& _size)
+    {
+        void* memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory != MAP_FAILED ? memory : nullptr;
+    }
+
+    void free_executable_memory(void* _memory, const std::size_t& _size)
+    {
+        munmap(_memory, _size);
+    }
+#else
+    void* allocate_host_memory(const std::size_t& _size, const bool& _hugePages)
+    {
+        return std::calloc(_size, 1);
+    }
+
+    void free_host_memory(void* _memory, const std::size_t& _size, const bool& _hugePages)
+    {
+        std::free(_memory);
+    }
+
+    void* allocate_executable_memory(const std::size_t& _size)
+    {
+        return nullptr;
+    }
+
+    void free_executable_memory(void* _memory, const std::size_t& _size)
+    {
+    }
+#endif
+}
\ No newline at end of file
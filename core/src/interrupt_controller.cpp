@@ -0,0 +1,64 @@
+#include "../include/interrupt_controller.h"
+#include "../include/bus.h"
+#include "../include/cpu.h"
+
+namespace br::gba
+{
+    void interrupt_controller::reset()
+    {
+        addressBus.set_io_register(IO_IE_ADDR, 0);
+        addressBus.set_io_register(IO_IF_ADDR, 0);
+        addressBus.set_io_register(IO_IME_ADDR, 0);
+        update();
+    }
+
+    void interrupt_controller::request(const u16& _interrupts)
+    {
+        addressBus.set_io_register(IO_IF_ADDR, addressBus.get_io_register(IO_IF_ADDR) | (_interrupts & IRQ_MASK));
+        update();
+    }
+
+    const bool interrupt_controller::is_requested()
+    {
+        return (addressBus.get_io_register(IO_IE_ADDR) & addressBus.get_io_register(IO_IF_ADDR)) != 0;
+    }
+
+    void interrupt_controller::update()
+    {
+        bool isRequested = is_requested();
+        if (isRequested && systemCPU.is_halted())
+            systemCPU.resume();
+
+        systemCPU.set_irq_line(isRequested && (addressBus.get_io_register(IO_IME_ADDR) & 0b1));
+    }
+
+    const u16 interrupt_controller::write_enable(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        addressBus.set_io_register(IO_IE_ADDR, ((_previous & ~_mask) | _data) & IRQ_MASK);
+        update();
+        return addressBus.get_io_register(IO_IE_ADDR);
+    }
+
+    const u16 interrupt_controller::write_flags(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        // writing a 1 acknowledges the interrupt
+        addressBus.set_io_register(IO_IF_ADDR, _previous & ~_data);
+        update();
+        return addressBus.get_io_register(IO_IF_ADDR);
+    }
+
+    const u16 interrupt_controller::write_master_enable(const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        addressBus.set_io_register(IO_IME_ADDR, ((_previous & ~_mask) | _data) & 0b1);
+        update();
+        return addressBus.get_io_register(IO_IME_ADDR);
+    }
+
+    interrupt_controller::interrupt_controller(bus& _addressBus, cpu& _systemCPU)
+        : addressBus{ _addressBus }, systemCPU{ _systemCPU }
+    {
+        addressBus.set_io_handler(IO_IE_ADDR, nullptr, std::bind(&interrupt_controller::write_enable, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        addressBus.set_io_handler(IO_IF_ADDR, nullptr, std::bind(&interrupt_controller::write_flags, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        addressBus.set_io_handler(IO_IME_ADDR, nullptr, std::bind(&interrupt_controller::write_master_enable, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    }
+}
@@ -0,0 +1,1151 @@
+#include "../include/recompiler.h"
+#include "../include/cpu.h"
+#include "../include/host_memory.h"
+
+namespace br::gba
+{
+    const bool recompiler::allocate()
+    {
+        if constexpr (!RECOMPILER_SUPPORTED)
+            return false;
+
+        if (codeMemory == nullptr)
+            codeMemory = static_cast<u8*>(allocate_executable_memory(RECOMPILER_CODE_SIZE));
+        return codeMemory != nullptr;
+    }
+
+    recompiler_block* recompiler::get_block(const u32& _address, const bool& _isThumb)
+    {
+        // blocks are found by halfword like the decoded cache, misaligned program counters stay in the interpreter
+        if (_address & (_isThumb ? 0b1 : 0b11))
+            return nullptr;
+
+        // flushed before a block is looked up, pointers into the blocks are only held while one runs
+        if (RECOMPILER_CODE_SIZE - codeUsed < RECOMPILER_BLOCK_MAX_SIZE)
+            flush();
+
+        u32 key = _address | _isThumb;
+        recompiler_block*& cachedBlock = lookup[(_address >> 1) & (RECOMPILER_LOOKUP_SIZE - 1)];
+        if (cachedBlock == nullptr || cachedBlock->key != key)
+        {
+            auto found = blocks.find(key);
+            if (found == blocks.end())
+            {
+                if (!addressBus.add_code_page(_address))
+                    return nullptr;
+
+                found = blocks.emplace(key, recompiler_block{ nullptr, key, 0, 0, nullptr, 0, {} }).first;
+            }
+            cachedBlock = &found->second;
+        }
+
+        recompiler_block& block = *cachedBlock;
+        if (block.code != nullptr)
+        {
+            if (*block.generationSource == block.generation)
+                return &block;
+
+            // rewritten code is cold again, code that keeps changing is left to the interpreter
+            block.code = nullptr;
+            block.hits = 0;
+        }
+
+        if (++block.hits < RECOMPILER_HOT_THRESHOLD || !translate(block, _address, _isThumb))
+            return nullptr;
+
+        return &block;
+    }
+
+    void recompiler::execute(recompiler_block& _block)
+    {
+        reinterpret_cast<void (*)(cpu*)>(_block.code)(&systemCPU);
+    }
+
+    void recompiler::flush()
+    {
+        blocks.clear();
+        lookup.fill(nullptr);
+        codeUsed = 0;
+    }
+
+    const bool recompiler::translate(recompiler_block& _block, const u32& _address, const bool& _isThumb)
+    {
+        isThumb = _isThumb;
+        wordLength = _isThumb ? THUMB_WORD_LENGTH : ARM_WORD_LENGTH;
+        fastPaths = addressBus.get_fast_paths();
+        instructions.clear();
+        exits.clear();
+        epilogueJumps.clear();
+        _block.fallbacks.clear();
+
+        // marked before the code is read, so writes from now on advance the generation
+        addressBus.add_code_page(_address);
+        _block.generationSource = addressBus.get_code_generation_source(_address);
+        _block.generation = *_block.generationSource;
+
+        // blocks end at a jump or at the end of their code page, one generation covers all of their code
+        u32 address = _address;
+        do
+        {
+            recompiler_instruction instruction = {};
+            instruction.address = address;
+            instruction.condition = ARM_CONDITION_ALWAYS;
+            instruction.regN = RECOMPILER_REGISTER_NONE;
+            if (_isThumb)
+                decode_thumb(_block, instruction, addressBus.read_16(address));
+            else
+                decode_arm(_block, instruction, addressBus.read_32(address));
+
+            instructions.push_back(instruction);
+            address += wordLength;
+        } while (!instructions.back().isBlockEnd && instructions.size() < RECOMPILER_BLOCK_MAX_INSTRUCTIONS && (address & (MEMORY_CODE_PAGE_SIZE - 1)) != 0);
+
+        allocate_registers();
+
+        u8* blockCode = codeMemory + codeUsed;
+        emitter.reset(blockCode, RECOMPILER_CODE_SIZE - codeUsed);
+        hasFlags = false;
+
+        emit_prologue();
+        for (u32 i = 0; i < instructions.size(); ++i)
+            emit_instruction(_block, instructions[i], i);
+        add_exit(emitter.jump(), (u32)instructions.size(), true, address);
+        emit_exits();
+        emit_epilogue();
+
+        if (emitter.has_overflowed())
+        {
+            flush();
+            return false;
+        }
+
+        // blocks start on a cache line
+        codeUsed += (emitter.get_size() + 63) & ~(std::size_t)63;
+        _block.code = blockCode;
+        _block.instructionCount = (u32)instructions.size();
+        return true;
+    }
+
+    void recompiler::decode_arm(recompiler_block& _block, recompiler_instruction& _instruction, const u32& _opcode)
+    {
+        cpu_decoded_instruction decoded = { nullptr, 0, CODE_CACHE_EMPTY };
+        systemCPU.decode_arm_opcode(_opcode, decoded);
+        if (decoded.isaIndex >= ARM_ISA_COUNT)
+        {
+            _instruction.operation = recompiler_operation::NONE;
+            return;
+        }
+
+        _instruction.condition = _opcode >> ARM_CONDITION_SHIFT;
+        const cpu_instruction& entry = systemCPU.armISA[decoded.isaIndex];
+        u32 regD = (_opcode >> 12) & 0b1111;
+        u32 regN = (_opcode >> 16) & 0b1111;
+        bool isImmediate = (_opcode >> 25) & 0b1;
+        u32 shiftType = (_opcode >> 5) & 0b11;
+        u32 shift = (_opcode >> 7) & 0b11111;
+
+        if (is_format(entry, ARM_DATAPROC_1_MASK, ARM_DATAPROC_1_TEST) || is_format(entry, ARM_DATAPROC_2_MASK, ARM_DATAPROC_2_TEST)
+            || is_format(entry, ARM_DATAPROC_3_MASK, ARM_DATAPROC_3_TEST))
+        {
+            u32 dataOpcode = (_opcode >> 21) & 0b1111;
+            bool setFlags = (_opcode >> 20) & 0b1;
+            bool isTest = dataOpcode >= 0x8 && dataOpcode <= 0xB;
+            bool shiftRegister = !isImmediate && ((_opcode >> 4) & 0b1);
+
+            // writes to the program counter jump or restore the spsr, shifts by a register, by 32 and RRX are left to the handler
+            bool writesProgramCounter = regD == REGISTER_PROGRAM_COUNTER_INDEX && (!isTest || setFlags);
+            bool isZeroShift = !isImmediate && !shiftRegister && shift == 0 && shiftType != 0;
+            if (writesProgramCounter || shiftRegister || isZeroShift || (isTest && !setFlags))
+            {
+                set_fallback(_block, _instruction, decoded, writesProgramCounter);
+                return;
+            }
+
+            _instruction.operation = recompiler_operation::DATA;
+            _instruction.dataOpcode = dataOpcode;
+            _instruction.setFlags = setFlags;
+            _instruction.regD = regD;
+            _instruction.regN = regN;
+            if (isImmediate)
+            {
+                u32 immediate = _opcode & 0xFF;
+                _instruction.operand = { true, rotate_right(immediate, ((_opcode >> 8) & 0b1111) << 1), immediate & 0b1, 0, 0 };
+            }
+            else
+            {
+                _instruction.operand = { false, _opcode & 0b1111, 0, shiftType, shift };
+            }
+            return;
+        }
+
+        if (is_format(entry, ARM_BRANCHING_2_MASK, ARM_BRANCHING_2_TEST))
+        {
+            s32 offset = ((s32)_opcode << 8) >> 6;
+            _instruction.operation = recompiler_operation::BRANCH;
+            _instruction.isBlockEnd = true;
+            _instruction.value = _instruction.address + ARM_WORD_LENGTH * 2 + offset;
+            // the link register gets the target, as in the handler
+            _instruction.link = (_opcode >> 24) & 0b1;
+            _instruction.linkValue = _instruction.value;
+            return;
+        }
+
+        if (is_format(entry, ARM_TRANSFER_1_MASK, ARM_TRANSFER_1_TEST) || is_format(entry, ARM_TRANSFER_2_MASK, ARM_TRANSFER_2_TEST))
+        {
+            bool isPreIndexed = (_opcode >> 24) & 0b1;
+            bool isByte = (_opcode >> 22) & 0b1;
+            bool isLoad = (_opcode >> 20) & 0b1;
+            bool writeBack = !isPreIndexed || ((_opcode >> 21) & 0b1);
+
+            // bit 25 selects a register offset
+            bool isZeroShift = isImmediate && shift == 0 && shiftType != 0;
+            bool writesProgramCounter = (isLoad && regD == REGISTER_PROGRAM_COUNTER_INDEX) || (writeBack && regN == REGISTER_PROGRAM_COUNTER_INDEX);
+            if (writesProgramCounter || isZeroShift)
+            {
+                set_fallback(_block, _instruction, decoded, writesProgramCounter);
+                return;
+            }
+
+            _instruction.operation = isLoad ? recompiler_operation::LOAD : recompiler_operation::STORE;
+            _instruction.regD = regD;
+            _instruction.regN = regN;
+            if (isImmediate)
+                _instruction.operand = { false, _opcode & 0b1111, 0, shiftType, shift };
+            else
+                _instruction.operand = { true, _opcode & 0xFFF, 0, 0, 0 };
+
+            // byte loads read the word and keep its low byte
+            _instruction.accessSize = isByte && !isLoad ? sizeof(u8) : sizeof(u32);
+            _instruction.cycleSize = isByte ? sizeof(u8) : sizeof(u32);
+            _instruction.isByteOfWord = isByte && isLoad;
+            _instruction.isPreIndexed = isPreIndexed;
+            _instruction.isUp = (_opcode >> 23) & 0b1;
+            _instruction.writeBack = writeBack;
+            return;
+        }
+
+        bool isBlockEnd = is_format(entry, ARM_BRANCHING_1_MASK, ARM_BRANCHING_1_TEST) || is_format(entry, ARM_SOFTINTERRUPT_MASK, ARM_SOFTINTERRUPT_TEST);
+        set_fallback(_block, _instruction, decoded, isBlockEnd);
+    }
+
+    void recompiler::decode_thumb(recompiler_block& _block, recompiler_instruction& _instruction, const u32& _opcode)
+    {
+        cpu_decoded_instruction decoded = { nullptr, 0, CODE_CACHE_EMPTY };
+        systemCPU.decode_thumb_opcode(_opcode, decoded);
+        if (decoded.isaIndex >= THUMB_ISA_COUNT)
+        {
+            _instruction.operation = recompiler_operation::NONE;
+            return;
+        }
+
+        const cpu_instruction& entry = systemCPU.thumbISA[decoded.isaIndex];
+        u32 programCounter = _instruction.address + THUMB_WORD_LENGTH;
+        u32 regD = _opcode & 0b111;
+        u32 regS = (_opcode >> 3) & 0b111;
+        u32 regHigh = (_opcode >> 8) & 0b111;
+
+        // data processing formats are translated as the arm instructions their handlers build
+        recompiler_instruction& data = _instruction;
+        data.operation = recompiler_operation::DATA;
+        data.setFlags = true;
+        data.regD = regD;
+
+        if (is_format(entry, THUMB_SHIFT_MASK, THUMB_SHIFT_TEST))
+        {
+            u32 shiftType = (_opcode >> 11) & 0b11;
+            u32 shift = (_opcode >> 6) & 0b11111;
+            if (shift == 0 && shiftType != 0)
+            {
+                set_fallback(_block, _instruction, decoded, false);
+                return;
+            }
+
+            data.dataOpcode = 0xD;
+            data.operand = { false, regS, 0, shiftType, shift };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_REG_MASK, THUMB_DATA_REG_TEST))
+        {
+            u32 operand = (_opcode >> 6) & 0b111;
+            data.dataOpcode = (_opcode >> 9) & 0b1 ? 0x2 : 0x4;
+            data.regN = regS;
+            data.operand = (_opcode >> 10) & 0b1 ? recompiler_operand{ true, operand, operand & 0b1, 0, 0 } : recompiler_operand{ false, operand, 0, 0, 0 };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_IMM_MASK, THUMB_DATA_IMM_TEST))
+        {
+            // MOV, CMP, ADD, SUB
+            static constexpr std::array<u32, 4> dataOpcodes = { 0xD, 0xA, 0x4, 0x2 };
+            u32 immediate = _opcode & 0xFF;
+            data.dataOpcode = dataOpcodes[(_opcode >> 11) & 0b11];
+            data.regD = regHigh;
+            data.regN = regHigh;
+            data.operand = { true, immediate, immediate & 0b1, 0, 0 };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_ALU_MASK, THUMB_DATA_ALU_TEST))
+        {
+            // shifts by a register and MUL are left to the handler
+            u32 aluType = (_opcode >> 6) & 0b1111;
+            bool isShift = aluType == 0x2 || aluType == 0x3 || aluType == 0x4 || aluType == 0x7;
+            if (isShift || aluType == 0xD)
+            {
+                set_fallback(_block, _instruction, decoded, false);
+                return;
+            }
+
+            // NEG is RSB Rd, Rs, #0
+            bool isNeg = aluType == 0x9;
+            data.dataOpcode = isNeg ? 0x3 : aluType;
+            data.regN = isNeg ? regS : regD;
+            data.operand = isNeg ? recompiler_operand{ true, 0, 0, 0, 0 } : recompiler_operand{ false, regS, 0, 0, 0 };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_HI_MASK, THUMB_DATA_HI_TEST))
+        {
+            // ADD, CMP, MOV, BX
+            static constexpr std::array<u32, 3> dataOpcodes = { 0x4, 0xA, 0xD };
+            u32 operation = (_opcode >> 8) & 0b11;
+            u32 regHighD = regD | ((_opcode >> 4) & 0b1000);
+            u32 regHighS = regS | ((_opcode >> 3) & 0b1000);
+            bool isCompare = operation == 0x1;
+            if (operation == 0x3 || (!isCompare && regHighD == REGISTER_PROGRAM_COUNTER_INDEX))
+            {
+                set_fallback(_block, _instruction, decoded, true);
+                return;
+            }
+
+            data.dataOpcode = dataOpcodes[operation];
+            data.setFlags = isCompare;
+            data.regD = regHighD;
+            data.regN = regHighD;
+            data.operand = { false, regHighS, 0, 0, 0 };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_STACK_MASK, THUMB_DATA_STACK_TEST))
+        {
+            data.dataOpcode = (_opcode >> 7) & 0b1 ? 0x2 : 0x4;
+            data.setFlags = false;
+            data.regD = REGISTER_STACK_POINTER_INDEX;
+            data.regN = REGISTER_STACK_POINTER_INDEX;
+            data.operand = { true, (_opcode & 0b1111111) * 4, 0, 0, 0 };
+            return;
+        }
+
+        if (is_format(entry, THUMB_DATA_ADR_MASK, THUMB_DATA_ADR_TEST))
+        {
+            // ADD SP takes the program counter as in the handler
+            u32 offset = (_opcode & 0xFF) * 4;
+            bool isStack = (_opcode >> 11) & 0b1;
+            _instruction.operation = recompiler_operation::SET;
+            _instruction.regD = regHigh;
+            _instruction.value = (isStack ? programCounter : (programCounter + ARM_WORD_LENGTH) & ~THUMB_WORD_LENGTH) + offset;
+            return;
+        }
+
+        // every transfer format adds an offset to its base and writes nothing back
+        recompiler_instruction& transfer = _instruction;
+        transfer.isPreIndexed = true;
+        transfer.isUp = true;
+        transfer.regD = regD;
+        transfer.regN = regS;
+
+        if (is_format(entry, THUMB_TRANS_RELATIVE_MASK, THUMB_TRANS_RELATIVE_TEST) || is_format(entry, THUMB_TRANS_STACK_MASK, THUMB_TRANS_STACK_TEST))
+        {
+            bool isRelative = is_format(entry, THUMB_TRANS_RELATIVE_MASK, THUMB_TRANS_RELATIVE_TEST);
+            bool isLoad = isRelative || ((_opcode >> 11) & 0b1);
+            transfer.operation = isLoad ? recompiler_operation::LOAD : recompiler_operation::STORE;
+            transfer.regD = regHigh;
+            transfer.regN = isRelative ? REGISTER_PROGRAM_COUNTER_INDEX : REGISTER_STACK_POINTER_INDEX;
+            transfer.operand = { true, (_opcode & 0xFF) * 4, 0, 0, 0 };
+            transfer.accessSize = sizeof(u32);
+            transfer.cycleSize = sizeof(u32);
+            return;
+        }
+
+        if (is_format(entry, THUMB_TRANS_SINGLE_MASK, THUMB_TRANS_SINGLE_TEST))
+        {
+            // STR, STRB, LDR, LDRB
+            u32 transType = (_opcode >> 10) & 0b11;
+            u32 size = transType & 0b1 ? sizeof(u8) : sizeof(u32);
+            transfer.operation = transType >> 1 ? recompiler_operation::LOAD : recompiler_operation::STORE;
+            transfer.operand = { false, (_opcode >> 6) & 0b111, 0, 0, 0 };
+            transfer.accessSize = size;
+            transfer.cycleSize = size;
+            return;
+        }
+
+        if (is_format(entry, THUMB_TRANS_EXTENDED_MASK, THUMB_TRANS_EXTENDED_TEST))
+        {
+            // STRH, LDSB, LDRH, LDSH, LDSH reads a byte without extending it like the handler
+            u32 transType = (_opcode >> 10) & 0b11;
+            transfer.operation = transType != 0 ? recompiler_operation::LOAD : recompiler_operation::STORE;
+            transfer.operand = { false, (_opcode >> 6) & 0b111, 0, 0, 0 };
+            transfer.accessSize = transType & 0b1 ? sizeof(u8) : sizeof(u16);
+            transfer.cycleSize = transType == 1 ? sizeof(u8) : sizeof(u16);
+            transfer.isSigned = transType == 1;
+            return;
+        }
+
+        if (is_format(entry, THUMB_TRANS_IMM_MASK, THUMB_TRANS_IMM_TEST) || is_format(entry, THUMB_TRANS_HALF_MASK, THUMB_TRANS_HALF_TEST))
+        {
+            // STR, LDR, STRB, LDRB or STRH, LDRH, all offsets are scaled by 2 as in the handlers
+            bool isHalf = is_format(entry, THUMB_TRANS_HALF_MASK, THUMB_TRANS_HALF_TEST);
+            u32 transType = (_opcode >> 11) & 0b11;
+            u32 size = isHalf ? sizeof(u16) : (transType >> 1 ? sizeof(u8) : sizeof(u32));
+            transfer.operation = transType & 0b1 ? recompiler_operation::LOAD : recompiler_operation::STORE;
+            transfer.operand = { true, ((_opcode >> 6) & 0b11111) * 2, 0, 0, 0 };
+            transfer.accessSize = size;
+            transfer.cycleSize = size;
+            return;
+        }
+
+        bool isConditional = is_format(entry, THUMB_COND_BRANCH_MASK, THUMB_COND_BRANCH_TEST);
+        if (isConditional || is_format(entry, THUMB_BRANCH_MASK, THUMB_BRANCH_TEST))
+        {
+            s32 offset = isConditional ? (s8)(_opcode & 0xFF) * 2 : (s32)((s16)((_opcode & 0x07FF) << 5)) >> 4;
+            _instruction.operation = recompiler_operation::BRANCH;
+            _instruction.condition = isConditional ? (_opcode >> 8) & 0xF : ARM_CONDITION_ALWAYS;
+            _instruction.isBlockEnd = true;
+            _instruction.value = programCounter + offset;
+            return;
+        }
+
+        // the first half of BL only sets the link register
+        bool isLinkSecond = (_opcode >> 11) & 0b1;
+        if (is_format(entry, THUMB_BRANCH_LINK_MASK, THUMB_BRANCH_LINK_TEST) && !isLinkSecond)
+        {
+            _instruction.operation = recompiler_operation::SET;
+            _instruction.regD = REGISTER_LINK_INDEX;
+            _instruction.value = programCounter + THUMB_WORD_LENGTH + ((_opcode & 0x7FF) << 12);
+            return;
+        }
+
+        bool isBlockEnd = is_format(entry, THUMB_BRANCH_LINK_MASK, THUMB_BRANCH_LINK_TEST) || is_format(entry, THUMB_SOFTINTERRUPT_MASK, THUMB_SOFTINTERRUPT_TEST);
+        set_fallback(_block, _instruction, decoded, isBlockEnd);
+    }
+
+    void recompiler::set_fallback(recompiler_block& _block, recompiler_instruction& _instruction, const cpu_decoded_instruction& _decoded, const bool& _isBlockEnd)
+    {
+        _instruction.operation = recompiler_operation::FALLBACK;
+        _instruction.isBlockEnd = _isBlockEnd;
+        _instruction.fallbackIndex = (u32)_block.fallbacks.size();
+        _block.fallbacks.push_back(_decoded);
+    }
+
+    const bool recompiler::is_format(const cpu_instruction& _entry, const u32& _mask, const u32& _test)
+    {
+        return _entry.data_mask == _mask && _entry.data_test == _test;
+    }
+
+    void recompiler::allocate_registers()
+    {
+        // the program counter is a constant in translated code
+        std::array<u32, REGISTER_PROGRAM_COUNTER_INDEX> uses{};
+        u32 written = 0;
+        auto use = [&](const u32& _index, const bool& _isWrite)
+        {
+            if (_index >= REGISTER_PROGRAM_COUNTER_INDEX)
+                return;
+            ++uses[_index];
+            written |= _isWrite << _index;
+        };
+
+        for (const recompiler_instruction& instruction : instructions)
+        {
+            switch (instruction.operation)
+            {
+            case recompiler_operation::DATA:
+                use(instruction.regD, instruction.dataOpcode < 0x8 || instruction.dataOpcode >= 0xC);
+                use(instruction.regN, false);
+                if (!instruction.operand.isImmediate)
+                    use(instruction.operand.value, false);
+                break;
+            case recompiler_operation::LOAD:
+            case recompiler_operation::STORE:
+                use(instruction.regD, instruction.operation == recompiler_operation::LOAD);
+                use(instruction.regN, instruction.writeBack);
+                if (!instruction.operand.isImmediate)
+                    use(instruction.operand.value, false);
+                break;
+            case recompiler_operation::SET:
+                use(instruction.regD, true);
+                break;
+            case recompiler_operation::BRANCH:
+                if (instruction.link)
+                    use(REGISTER_LINK_INDEX, true);
+                break;
+            default:
+                break;
+            }
+        }
+
+        allocation.fill(RECOMPILER_REGISTER_NONE);
+        writtenRegisters = 0;
+        for (u32 i = 0; i < RECOMPILER_GUEST_REGISTERS.size(); ++i)
+        {
+            u32 best = 0;
+            for (u32 index = 1; index < uses.size(); ++index)
+                best = uses[index] > uses[best] ? index : best;
+
+            // a single use costs more to load and store than it saves
+            if (uses[best] < 2)
+                break;
+
+            allocation[best] = (u8)i;
+            writtenRegisters |= written & (1 << best);
+            uses[best] = 0;
+        }
+    }
+
+    void recompiler::emit_prologue()
+    {
+        for (x64_register saved : { x64_register::RBX, x64_register::RBP, x64_register::R12, x64_register::R13, x64_register::R14, x64_register::R15 })
+            emitter.push(saved);
+
+        // scratch for the address of a transfer and its written back base, keeps calls 16 byte aligned
+        emitter.alu(x64_operation::SUB, x64_register::RSP, 8, true);
+        emitter.mov(RECOMPILER_CPU_REGISTER, x64_register::RDI, true);
+        emitter.mov_64(RECOMPILER_CYCLES_REGISTER, reinterpret_cast<u64>(fastPaths.accessCycles));
+        reload_registers();
+    }
+
+    void recompiler::emit_epilogue()
+    {
+        for (const std::size_t& label : epilogueJumps)
+            emitter.bind(label);
+
+        // eax holds the instructions run
+        emitter.alu(x64_operation::ADD, get_cpu_field(&systemCPU.runInstructions), x64_register::RAX, true);
+        emitter.alu(x64_operation::ADD, x64_register::RSP, 8, true);
+        for (x64_register saved : { x64_register::R15, x64_register::R14, x64_register::R13, x64_register::R12, x64_register::RBP, x64_register::RBX })
+            emitter.pop(saved);
+        emitter.ret();
+    }
+
+    void recompiler::emit_exits()
+    {
+        for (const recompiler_exit& exit : exits)
+        {
+            emitter.bind(exit.label);
+            spill_registers();
+            if (exit.storesProgramCounter)
+                emitter.mov(get_cpu_field(&systemCPU.registers[REGISTER_PROGRAM_COUNTER_INDEX]), exit.programCounter);
+
+            if (exit.completesJump)
+            {
+                emitter.mov(x64_register::RDI, RECOMPILER_CPU_REGISTER, true);
+                emitter.mov(x64_register::RSI, exit.fetchAddress);
+                emitter.mov(x64_register::RDX, (u32)isThumb);
+                emitter.call(reinterpret_cast<const void*>(&recompiler::complete_jump));
+            }
+
+            emitter.mov(x64_register::RAX, exit.count);
+            epilogueJumps.push_back(emitter.jump());
+        }
+    }
+
+    void recompiler::emit_instruction(recompiler_block& _block, const recompiler_instruction& _instruction, const u32& _index)
+    {
+        // the run loop tests the budget before every instruction, the block is only entered when the first one fits
+        if (_index > 0)
+        {
+            emitter.mov(x64_register::RAX, get_cpu_field(&systemCPU.runCycles));
+            emitter.alu(x64_operation::CMP, x64_register::RAX, get_cpu_field(&systemCPU.runBudget));
+            add_exit(emitter.jump(x64_condition::ABOVE_EQUAL), _index, true, _instruction.address);
+        }
+
+        // handlers read the program counter from the cpu, it is also tested after a skipped one
+        u32 nextAddress = _instruction.address + wordLength;
+        if (_instruction.operation == recompiler_operation::FALLBACK)
+            emitter.mov(get_cpu_field(&systemCPU.registers[REGISTER_PROGRAM_COUNTER_INDEX]), nextAddress);
+
+        std::size_t skipLabel = emit_condition(_instruction.condition);
+        switch (_instruction.operation)
+        {
+        case recompiler_operation::FALLBACK:
+            emit_fallback(_block, _instruction);
+            break;
+        case recompiler_operation::NONE:
+            break;
+        case recompiler_operation::DATA:
+            emit_data(_instruction);
+            break;
+        case recompiler_operation::LOAD:
+        case recompiler_operation::STORE:
+            emit_transfer(_instruction);
+            break;
+        case recompiler_operation::BRANCH:
+            emit_branch(_instruction, _index);
+            break;
+        case recompiler_operation::SET:
+            emitter.mov(x64_register::RAX, _instruction.value);
+            store_register(_instruction.regD, x64_register::RAX);
+            break;
+        }
+
+        // instructions failing their condition still take their fetch
+        if (skipLabel != 0)
+            emitter.bind(skipLabel);
+        emit_fetch_cycles(_instruction.address);
+
+        if (_instruction.operation == recompiler_operation::FALLBACK)
+        {
+            // the refill and the end of the run for a switch of instruction set are left to the core
+            emitter.alu(x64_operation::CMP, get_cpu_field(&systemCPU.registers[REGISTER_PROGRAM_COUNTER_INDEX]), (s32)nextAddress);
+            add_exit(emitter.jump(x64_condition::NOT_EQUAL), _index + 1, false, 0, true, _instruction.address);
+            hasFlags = false;
+        }
+
+        if (_instruction.operation == recompiler_operation::FALLBACK || _instruction.operation == recompiler_operation::STORE)
+            emit_generation_check(_block, _index + 1, nextAddress);
+    }
+
+    void recompiler::emit_fallback(recompiler_block& _block, const recompiler_instruction& _instruction)
+    {
+        // handlers read the registers from the cpu
+        spill_registers();
+        emitter.mov(x64_register::RDI, RECOMPILER_CPU_REGISTER, true);
+        emitter.mov_64(x64_register::RSI, reinterpret_cast<u64>(&_block.fallbacks[_instruction.fallbackIndex]));
+        emitter.call(reinterpret_cast<const void*>(&recompiler::execute_handler));
+        emitter.alu(x64_operation::ADD, get_cpu_field(&systemCPU.runCycles), x64_register::RAX);
+        reload_registers();
+    }
+
+    void recompiler::emit_data(const recompiler_instruction& _instruction)
+    {
+        u32 dataOpcode = _instruction.dataOpcode;
+        u32 programCounter = _instruction.address + wordLength;
+        bool isLogical = dataOpcode <= 0x1 || dataOpcode == 0x8 || dataOpcode == 0x9 || dataOpcode >= 0xC;
+        bool usesCarry = dataOpcode >= 0x5 && dataOpcode <= 0x7;
+        bool isSubtraction = dataOpcode == 0x2 || dataOpcode == 0x3 || dataOpcode == 0x6 || dataOpcode == 0x7 || dataOpcode == 0xA;
+        bool setRegister = dataOpcode < 0x8 || dataOpcode >= 0xC;
+        if ((_instruction.setFlags || usesCarry) && !hasFlags)
+            emit_materialize_flags();
+
+        u32 carry = emit_operand(_instruction.operand, programCounter, _instruction.setFlags && isLogical);
+        if (dataOpcode != 0xD && dataOpcode != 0xF)
+            load_register(x64_register::RAX, _instruction.regN, programCounter);
+
+        // arithmetic is done on the zero extended operands in 64 bits, the flags are derived from that like in the core
+        if (usesCarry)
+        {
+            emitter.mov(x64_register::RDX, get_cpu_field(&systemCPU.statusRegister));
+            emitter.shift(x64_shift::SHR, x64_register::RDX, STATUS_REGISTER_C_SHIFT);
+            emitter.alu(x64_operation::AND, x64_register::RDX, 1);
+        }
+
+        switch (dataOpcode)
+        {
+        case 0x0: // AND
+        case 0x8: // TST
+            emitter.alu(x64_operation::AND, x64_register::RAX, x64_register::RCX);
+            break;
+        case 0x1: // EOR
+        case 0x9: // TEQ
+            emitter.alu(x64_operation::XOR, x64_register::RAX, x64_register::RCX);
+            break;
+        case 0x2: // SUB
+        case 0xA: // CMP
+            emitter.alu(x64_operation::SUB, x64_register::RAX, x64_register::RCX, true);
+            break;
+        case 0x3: // RSB
+            emitter.alu(x64_operation::SUB, x64_register::RCX, x64_register::RAX, true);
+            emitter.mov(x64_register::RAX, x64_register::RCX, true);
+            break;
+        case 0x4: // ADD
+        case 0xB: // CMN
+            emitter.alu(x64_operation::ADD, x64_register::RAX, x64_register::RCX, true);
+            break;
+        case 0x5: // ADC
+            emitter.alu(x64_operation::ADD, x64_register::RAX, x64_register::RCX, true);
+            emitter.alu(x64_operation::ADD, x64_register::RAX, x64_register::RDX, true);
+            break;
+        case 0x6: // SBC
+            emitter.alu(x64_operation::SUB, x64_register::RAX, x64_register::RCX, true);
+            emitter.alu(x64_operation::ADD, x64_register::RAX, x64_register::RDX, true);
+            emitter.alu(x64_operation::SUB, x64_register::RAX, 1, true);
+            break;
+        case 0x7: // RSC
+            emitter.alu(x64_operation::SUB, x64_register::RCX, x64_register::RAX, true);
+            emitter.alu(x64_operation::ADD, x64_register::RCX, x64_register::RDX, true);
+            emitter.alu(x64_operation::SUB, x64_register::RCX, 1, true);
+            emitter.mov(x64_register::RAX, x64_register::RCX, true);
+            break;
+        case 0xC: // ORR
+            emitter.alu(x64_operation::OR, x64_register::RAX, x64_register::RCX);
+            break;
+        case 0xD: // MOV
+            emitter.mov(x64_register::RAX, x64_register::RCX);
+            break;
+        case 0xE: // BIC
+            emitter.not_(x64_register::RCX);
+            emitter.alu(x64_operation::AND, x64_register::RAX, x64_register::RCX);
+            break;
+        case 0xF: // MVN
+            emitter.not_(x64_register::RCX);
+            emitter.mov(x64_register::RAX, x64_register::RCX);
+            break;
+        }
+
+        if (setRegister)
+            store_register(_instruction.regD, x64_register::RAX);
+        if (_instruction.setFlags)
+            emit_flags(isLogical, isSubtraction, carry);
+    }
+
+    void recompiler::emit_transfer(const recompiler_instruction& _instruction)
+    {
+        u32 programCounter = _instruction.address + wordLength;
+        bool isLoad = _instruction.operation == recompiler_operation::LOAD;
+        x64_operation offsetOperation = _instruction.isUp ? x64_operation::ADD : x64_operation::SUB;
+
+        load_register(x64_register::RSI, _instruction.regN, programCounter);
+        if (!_instruction.operand.isImmediate)
+            emit_operand(_instruction.operand, programCounter, false);
+
+        auto apply_offset = [&](const x64_register& _base)
+        {
+            if (_instruction.operand.isImmediate)
+                emitter.alu(offsetOperation, _base, (s32)_instruction.operand.value);
+            else
+                emitter.alu(offsetOperation, _base, x64_register::RCX);
+        };
+
+        if (_instruction.isPreIndexed)
+        {
+            apply_offset(x64_register::RSI);
+            if (_instruction.writeBack)
+                store_register(_instruction.regN, x64_register::RSI);
+        }
+
+        // the bus calls clobber the scratch registers, the address and the post indexed base are kept on the stack
+        emitter.mov(x64_memory(x64_register::RSP), x64_register::RSI);
+        if (!_instruction.isPreIndexed)
+        {
+            emitter.mov(x64_register::RDI, x64_register::RSI);
+            apply_offset(x64_register::RDI);
+            emitter.mov(x64_memory(x64_register::RSP, 4), x64_register::RDI);
+        }
+
+        if (isLoad)
+        {
+            emit_read(_instruction.accessSize);
+            if (_instruction.isByteOfWord)
+                emitter.movzx_8(x64_register::RAX, x64_register::RAX);
+            if (_instruction.isSigned)
+                emitter.movsx_8(x64_register::RAX, x64_register::RAX);
+            store_register(_instruction.regD, x64_register::RAX);
+        }
+        else
+        {
+            // stores read the register after a pre indexed write back
+            load_register(x64_register::RDX, _instruction.regD, programCounter);
+            emit_write(_instruction.accessSize);
+        }
+
+        if (!_instruction.isPreIndexed)
+        {
+            emitter.mov(x64_register::RAX, x64_memory(x64_register::RSP, 4));
+            store_register(_instruction.regN, x64_register::RAX);
+        }
+
+        // loads take an internal cycle to write the register
+        emit_data_cycles(_instruction.cycleSize, isLoad);
+    }
+
+    void recompiler::emit_branch(const recompiler_instruction& _instruction, const u32& _index)
+    {
+        if (_instruction.link)
+        {
+            emitter.mov(x64_register::RAX, _instruction.linkValue);
+            store_register(REGISTER_LINK_INDEX, x64_register::RAX);
+        }
+
+        // a branch to the next instruction does not refill the pipeline
+        if (_instruction.value == _instruction.address + wordLength)
+            return;
+
+        emit_fetch_cycles(_instruction.address);
+        add_exit(emitter.jump(), _index + 1, true, _instruction.value, true, _instruction.address);
+    }
+
+    const u32 recompiler::emit_operand(const recompiler_operand& _operand, const u32& _programCounter, const bool& _carry)
+    {
+        if (_operand.isImmediate)
+        {
+            emitter.mov(x64_register::RCX, _operand.value);
+            return _operand.carry;
+        }
+
+        load_register(x64_register::RCX, _operand.value, _programCounter);
+
+        // LSL #0 keeps the operand and clears the carry, as in the core
+        u8 shift = (u8)_operand.shiftAmount;
+        if (shift == 0)
+            return 0;
+
+        // LSL takes the carry from bit 32 - n, LSR and ASR from bit n - 1, ROR from bit 0
+        static constexpr std::array<x64_shift, 4> shifts = { x64_shift::SHL, x64_shift::SHR, x64_shift::SAR, x64_shift::ROR };
+        if (_carry)
+        {
+            emitter.mov(x64_register::R8, x64_register::RCX);
+            switch (_operand.shiftType)
+            {
+            case 0x0:
+                emitter.shift(x64_shift::SHR, x64_register::R8, 32 - shift);
+                break;
+            case 0x1:
+            case 0x2:
+                emitter.shift(shifts[_operand.shiftType], x64_register::R8, shift - 1);
+                break;
+            }
+            emitter.alu(x64_operation::AND, x64_register::R8, 1);
+        }
+
+        emitter.shift(shifts[_operand.shiftType], x64_register::RCX, shift);
+        return _carry ? RECOMPILER_CARRY_COMPUTED : 0;
+    }
+
+    void recompiler::emit_flags(const bool& _isLogical, const bool& _isSubtraction, const u32& _carry)
+    {
+        // NZCV are collected in the low nibble of edx
+        emitter.mov(x64_register::RDX, x64_register::RAX);
+        emitter.shift(x64_shift::SHR, x64_register::RDX, 28);
+        emitter.alu(x64_operation::AND, x64_register::RDX, 0b1000);
+
+        emitter.alu(x64_operation::XOR, x64_register::RCX, x64_register::RCX);
+        emitter.test(x64_register::RAX, x64_register::RAX);
+        emitter.setcc(x64_condition::EQUAL, x64_register::RCX);
+        emitter.shift(x64_shift::SHL, x64_register::RCX, 2);
+        emitter.alu(x64_operation::OR, x64_register::RDX, x64_register::RCX);
+
+        u32 keptFlags = ~(STATUS_REGISTER_N | STATUS_REGISTER_Z | STATUS_REGISTER_C | STATUS_REGISTER_V);
+        if (_isLogical)
+        {
+            // logical operations keep V
+            keptFlags |= STATUS_REGISTER_V;
+            if (_carry == RECOMPILER_CARRY_COMPUTED)
+            {
+                emitter.shift(x64_shift::SHL, x64_register::R8, 1);
+                emitter.alu(x64_operation::OR, x64_register::RDX, x64_register::R8);
+            }
+            else if (_carry != 0)
+            {
+                emitter.alu(x64_operation::OR, x64_register::RDX, 0b10);
+            }
+        }
+        else
+        {
+            // additions carry into bit 32, subtractions borrow when the result is negative
+            emitter.mov(x64_register::RCX, x64_register::RAX, true);
+            if (_isSubtraction)
+            {
+                emitter.shift(x64_shift::SHR, x64_register::RCX, 63, true);
+                emitter.alu(x64_operation::XOR, x64_register::RCX, 1);
+            }
+            else
+            {
+                emitter.shift(x64_shift::SHR, x64_register::RCX, 32, true);
+                emitter.alu(x64_operation::AND, x64_register::RCX, 1);
+            }
+            emitter.shift(x64_shift::SHL, x64_register::RCX, 1);
+            emitter.alu(x64_operation::OR, x64_register::RDX, x64_register::RCX);
+
+            // the result overflows when it is outside of the signed 32 bit range
+            emitter.mov_64(x64_register::RCX, 0x80000000);
+            emitter.alu(x64_operation::ADD, x64_register::RCX, x64_register::RAX, true);
+            emitter.shift(x64_shift::SHR, x64_register::RCX, 32, true);
+            emitter.alu(x64_operation::XOR, x64_register::R8, x64_register::R8);
+            emitter.test(x64_register::RCX, x64_register::RCX, true);
+            emitter.setcc(x64_condition::NOT_EQUAL, x64_register::R8);
+            emitter.alu(x64_operation::OR, x64_register::RDX, x64_register::R8);
+        }
+
+        emitter.shift(x64_shift::SHL, x64_register::RDX, STATUS_REGISTER_V_SHIFT);
+        emitter.mov(x64_register::RCX, get_cpu_field(&systemCPU.statusRegister));
+        emitter.alu(x64_operation::AND, x64_register::RCX, (s32)keptFlags);
+        emitter.alu(x64_operation::OR, x64_register::RCX, x64_register::RDX);
+        emitter.mov(get_cpu_field(&systemCPU.statusRegister), x64_register::RCX);
+    }
+
+    void recompiler::emit_read(const u32& _size)
+    {
+        // aligned reads from pages with backing memory are inlined, everything else goes through the bus
+        std::array<std::size_t, 3> slowLabels{};
+        emitter.alu(x64_operation::CMP, x64_register::RSI, (s32)MEMORY_ADDRESS_LIMIT);
+        slowLabels[0] = emitter.jump(x64_condition::ABOVE_EQUAL);
+        emitter.mov(x64_register::RAX, x64_register::RSI);
+        emitter.shift(x64_shift::SHR, x64_register::RAX, MEMORY_PAGE_SHIFT);
+        emitter.mov_64(x64_register::RDX, reinterpret_cast<u64>(fastPaths.readPages));
+        emitter.mov(x64_register::RDX, x64_memory(x64_register::RDX, x64_register::RAX, 3), true);
+        emitter.test(x64_register::RDX, x64_register::RDX, true);
+        slowLabels[1] = emitter.jump(x64_condition::EQUAL);
+        if (_size > 1)
+        {
+            emitter.test(x64_register::RSI, _size - 1);
+            slowLabels[2] = emitter.jump(x64_condition::NOT_EQUAL);
+        }
+
+        emitter.mov(x64_register::RAX, x64_register::RSI);
+        emitter.alu(x64_operation::AND, x64_register::RAX, (s32)MEMORY_PAGE_MASK);
+        x64_memory memory(x64_register::RDX, x64_register::RAX, 0);
+        if (_size == sizeof(u32))
+            emitter.mov(x64_register::RAX, memory);
+        else if (_size == sizeof(u16))
+            emitter.movzx_16(x64_register::RAX, memory);
+        else
+            emitter.movzx_8(x64_register::RAX, memory);
+        std::size_t doneLabel = emitter.jump();
+
+        for (const std::size_t& label : slowLabels)
+        {
+            if (label != 0)
+                emitter.bind(label);
+        }
+
+        const std::array<const void*, 3> reads = { reinterpret_cast<const void*>(&recompiler::read_8), reinterpret_cast<const void*>(&recompiler::read_16),
+            reinterpret_cast<const void*>(&recompiler::read_32) };
+        emitter.mov_64(x64_register::RDI, reinterpret_cast<u64>(&addressBus));
+        emitter.call(reads[_size >> 1]);
+        emitter.bind(doneLabel);
+    }
+
+    void recompiler::emit_write(const u32& _size)
+    {
+        // aligned writes to pages with backing memory are inlined unless the page holds code,
+        // the bus advances the code generations then
+        std::array<std::size_t, 4> slowLabels{};
+        emitter.alu(x64_operation::CMP, x64_register::RSI, (s32)MEMORY_ADDRESS_LIMIT);
+        slowLabels[0] = emitter.jump(x64_condition::ABOVE_EQUAL);
+        emitter.mov(x64_register::RAX, x64_register::RSI);
+        emitter.shift(x64_shift::SHR, x64_register::RAX, MEMORY_PAGE_SHIFT);
+        emitter.mov_64(x64_register::RCX, reinterpret_cast<u64>(fastPaths.writePages));
+        emitter.mov(x64_register::RCX, x64_memory(x64_register::RCX, x64_register::RAX, 3), true);
+        emitter.test(x64_register::RCX, x64_register::RCX, true);
+        slowLabels[1] = emitter.jump(x64_condition::EQUAL);
+        if (_size > 1)
+        {
+            emitter.test(x64_register::RSI, _size - 1);
+            slowLabels[2] = emitter.jump(x64_condition::NOT_EQUAL);
+        }
+
+        // rcx points at the written memory, edi gets its offset in the arena
+        emitter.mov(x64_register::RAX, x64_register::RSI);
+        emitter.alu(x64_operation::AND, x64_register::RAX, (s32)MEMORY_PAGE_MASK);
+        emitter.alu(x64_operation::ADD, x64_register::RCX, x64_register::RAX, true);
+        emitter.mov_64(x64_register::RAX, reinterpret_cast<u64>(fastPaths.arena));
+        emitter.mov(x64_register::RAX, x64_memory(x64_register::RAX), true);
+        emitter.mov(x64_register::RDI, x64_register::RCX, true);
+        emitter.alu(x64_operation::SUB, x64_register::RDI, x64_register::RAX, true);
+
+        emitter.mov(x64_register::RAX, x64_register::RDI);
+        emitter.shift(x64_shift::SHR, x64_register::RAX, MEMORY_CODE_PAGE_SHIFT);
+        emitter.mov(x64_register::R8, x64_register::RAX);
+        emitter.shift(x64_shift::SHR, x64_register::R8, 6);
+        emitter.mov_64(x64_register::R9, reinterpret_cast<u64>(fastPaths.codePages));
+        emitter.mov(x64_register::R9, x64_memory(x64_register::R9, x64_register::R8, 3), true);
+        emitter.bt(x64_register::R9, x64_register::RAX, true);
+        slowLabels[3] = emitter.jump(x64_condition::BELOW);
+
+        // aligned accesses never cross a dirty block
+        emitter.mov_64(x64_register::R8, reinterpret_cast<u64>(fastPaths.memoryGeneration));
+        emitter.mov(x64_register::R8, x64_memory(x64_register::R8));
+        emitter.mov_64(x64_register::R9, reinterpret_cast<u64>(fastPaths.blockGenerations));
+        emitter.shift(x64_shift::SHR, x64_register::RDI, MEMORY_DIRTY_BLOCK_SHIFT);
+        emitter.mov(x64_memory(x64_register::R9, x64_register::RDI, 2), x64_register::R8);
+
+        x64_memory memory(x64_register::RCX);
+        if (_size == sizeof(u32))
+            emitter.mov(memory, x64_register::RDX);
+        else if (_size == sizeof(u16))
+            emitter.mov_16(memory, x64_register::RDX);
+        else
+            emitter.mov_8(memory, x64_register::RDX);
+        std::size_t doneLabel = emitter.jump();
+
+        for (const std::size_t& label : slowLabels)
+        {
+            if (label != 0)
+                emitter.bind(label);
+        }
+
+        const std::array<const void*, 3> writes = { reinterpret_cast<const void*>(&recompiler::write_8), reinterpret_cast<const void*>(&recompiler::write_16),
+            reinterpret_cast<const void*>(&recompiler::write_32) };
+        emitter.mov_64(x64_register::RDI, reinterpret_cast<u64>(&addressBus));
+        emitter.call(writes[_size >> 1]);
+        emitter.bind(doneLabel);
+    }
+
+    void recompiler::emit_fetch_cycles(const u32& _address)
+    {
+        // nothing is mapped past the regions, the access still takes a cycle
+        if (_address >= MEMORY_ADDRESS_LIMIT)
+        {
+            emitter.alu(x64_operation::ADD, get_cpu_field(&systemCPU.runCycles), 1);
+            return;
+        }
+
+        u32 access = (u32)(isThumb ? bus_access::SEQUENTIAL_16 : bus_access::SEQUENTIAL_32);
+        emitter.movzx_8(x64_register::RDX, x64_memory(RECOMPILER_CYCLES_REGISTER, (s32)(access * MEMORY_REGION_COUNT + (_address >> MEMORY_REGION_SHIFT))));
+        emitter.alu(x64_operation::ADD, get_cpu_field(&systemCPU.runCycles), x64_register::RDX);
+    }
+
+    void recompiler::emit_data_cycles(const u32& _size, const u32& _internalCycles)
+    {
+        u32 access = (u32)(_size == sizeof(u32) ? bus_access::NONSEQUENTIAL_32 : bus_access::NONSEQUENTIAL_16);
+        emitter.mov(x64_register::RCX, x64_memory(x64_register::RSP));
+        emitter.mov(x64_register::RDX, 1u);
+        emitter.alu(x64_operation::CMP, x64_register::RCX, (s32)MEMORY_ADDRESS_LIMIT);
+        std::size_t unmappedLabel = emitter.jump(x64_condition::ABOVE_EQUAL);
+        emitter.shift(x64_shift::SHR, x64_register::RCX, MEMORY_REGION_SHIFT);
+        emitter.movzx_8(x64_register::RDX, x64_memory(RECOMPILER_CYCLES_REGISTER, x64_register::RCX, 0, (s32)(access * MEMORY_REGION_COUNT)));
+        emitter.bind(unmappedLabel);
+
+        if (_internalCycles != 0)
+            emitter.alu(x64_operation::ADD, x64_register::RDX, (s32)_internalCycles);
+        emitter.alu(x64_operation::ADD, get_cpu_field(&systemCPU.runCycles), x64_register::RDX);
+    }
+
+    void recompiler::emit_materialize_flags()
+    {
+        emitter.alu(x64_operation::CMP, get_cpu_field(&systemCPU.flagOperation), 0);
+        std::size_t materializedLabel = emitter.jump(x64_condition::EQUAL);
+        emitter.mov(x64_register::RDI, RECOMPILER_CPU_REGISTER, true);
+        emitter.call(reinterpret_cast<const void*>(&recompiler::materialize_flags));
+        emitter.bind(materializedLabel);
+        hasFlags = true;
+    }
+
+    const std::size_t recompiler::emit_condition(const u32& _condition)
+    {
+        if (_condition == ARM_CONDITION_ALWAYS)
+            return 0;
+
+        if (!hasFlags)
+            emit_materialize_flags();
+
+        emitter.mov(x64_register::RAX, get_cpu_field(&systemCPU.statusRegister));
+        emitter.shift(x64_shift::SHR, x64_register::RAX, STATUS_REGISTER_V_SHIFT);
+        emitter.mov(x64_register::RDX, (u32)CONDITION_TABLE[_condition]);
+        emitter.bt(x64_register::RDX, x64_register::RAX);
+        return emitter.jump(x64_condition::ABOVE_EQUAL);
+    }
+
+    void recompiler::add_exit(const std::size_t& _label, const u32& _count, const bool& _storesProgramCounter, const u32& _programCounter, const bool& _completesJump, const u32& _fetchAddress)
+    {
+        exits.push_back({ _label, _count, _storesProgramCounter, _programCounter, _completesJump, _fetchAddress });
+    }
+
+    void recompiler::emit_generation_check(const recompiler_block& _block, const u32& _count, const u32& _programCounter)
+    {
+        emitter.mov_64(x64_register::RAX, reinterpret_cast<u64>(_block.generationSource));
+        emitter.alu(x64_operation::CMP, x64_memory(x64_register::RAX), (s32)_block.generation);
+        add_exit(emitter.jump(x64_condition::NOT_EQUAL), _count, true, _programCounter);
+    }
+
+    void recompiler::load_register(const x64_register& _destination, const u32& _index, const u32& _programCounter)
+    {
+        if (_index == REGISTER_PROGRAM_COUNTER_INDEX)
+            emitter.mov(_destination, _programCounter);
+        else if (allocation[_index] != RECOMPILER_REGISTER_NONE)
+            emitter.mov(_destination, RECOMPILER_GUEST_REGISTERS[allocation[_index]]);
+        else
+            emitter.mov(_destination, get_cpu_field(&systemCPU.registers[_index]));
+    }
+
+    void recompiler::store_register(const u32& _index, const x64_register& _source)
+    {
+        if (allocation[_index] != RECOMPILER_REGISTER_NONE)
+            emitter.mov(RECOMPILER_GUEST_REGISTERS[allocation[_index]], _source);
+        else
+            emitter.mov(get_cpu_field(&systemCPU.registers[_index]), _source);
+    }
+
+    void recompiler::spill_registers()
+    {
+        for (u32 i = 0; i < REGISTER_PROGRAM_COUNTER_INDEX; ++i)
+        {
+            if ((writtenRegisters >> i) & 0b1)
+                emitter.mov(get_cpu_field(&systemCPU.registers[i]), RECOMPILER_GUEST_REGISTERS[allocation[i]]);
+        }
+    }
+
+    void recompiler::reload_registers()
+    {
+        for (u32 i = 0; i < REGISTER_PROGRAM_COUNTER_INDEX; ++i)
+        {
+            if (allocation[i] != RECOMPILER_REGISTER_NONE)
+                emitter.mov(RECOMPILER_GUEST_REGISTERS[allocation[i]], get_cpu_field(&systemCPU.registers[i]));
+        }
+    }
+
+    x64_memory recompiler::get_cpu_field(const void* _field)
+    {
+        return x64_memory(RECOMPILER_CPU_REGISTER, (s32)(static_cast<const u8*>(_field) - reinterpret_cast<const u8*>(&systemCPU)));
+    }
+
+    const u32 recompiler::execute_handler(cpu* _cpu, const cpu_decoded_instruction* _instruction)
+    {
+        return (_cpu->*_instruction->execute)(_instruction->opcode);
+    }
+
+    void recompiler::materialize_flags(cpu* _cpu)
+    {
+        _cpu->materialize_flags();
+    }
+
+    void recompiler::complete_jump(cpu* _cpu, const u32 _fetchAddress, const u32 _isThumb)
+    {
+        _cpu->runCycles += _cpu->complete_jump(_fetchAddress, _isThumb);
+    }
+
+    const u32 recompiler::read_32(bus* _bus, const u32 _address)
+    {
+        return _bus->read_32(_address);
+    }
+
+    const u32 recompiler::read_16(bus* _bus, const u32 _address)
+    {
+        return _bus->read_16(_address);
+    }
+
+    const u32 recompiler::read_8(bus* _bus, const u32 _address)
+    {
+        return _bus->read_8(_address);
+    }
+
+    void recompiler::write_32(bus* _bus, const u32 _address, const u32 _data)
+    {
+        _bus->write_32(_address, _data);
+    }
+
+    void recompiler::write_16(bus* _bus, const u32 _address, const u32 _data)
+    {
+        _bus->write_16(_address, (u16)_data);
+    }
+
+    void recompiler::write_8(bus* _bus, const u32 _address, const u32 _data)
+    {
+        _bus->write_8(_address, (u8)_data);
+    }
+
+    recompiler::recompiler(cpu& _systemCPU, bus& _addressBus)
+        : systemCPU{ _systemCPU }, addressBus{ _addressBus }, codeMemory{ nullptr }, codeUsed{ 0 }, fastPaths{},
+          isThumb{ false }, wordLength{ ARM_WORD_LENGTH }, writtenRegisters{ 0 }, hasFlags{ false }
+    {
+        lookup.fill(nullptr);
+        allocation.fill(RECOMPILER_REGISTER_NONE);
+    }
+
+    recompiler::~recompiler()
+    {
+        if (codeMemory != nullptr)
+            free_executable_memory(codeMemory, RECOMPILER_CODE_SIZE);
+    }
+}
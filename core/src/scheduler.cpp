@@ -0,0 +1,126 @@
+#include "../include/scheduler.h"
+#include <algorithm>
+
+namespace br::gba
+{
+    const u32 scheduler::add_event(const scheduler_callback& _callback)
+    {
+        slots.push_back({ _callback, SCHEDULER_NEVER, SCHEDULER_NEVER });
+        return slots.size() - 1;
+    }
+
+    void scheduler::schedule(const u32& _event, const u64& _timestamp)
+    {
+        scheduler_slot& slot = slots[_event];
+        slot.order = nextOrder++;
+        slot.timestamp = _timestamp;
+
+        entries.push_back({ _timestamp, slot.order, _event });
+        std::push_heap(entries.begin(), entries.end(), compare_entries);
+
+        // events rescheduled before they are due leave their old entries deep in the heap
+        if (entries.size() > slots.size() * 4 + 16)
+            compact();
+    }
+
+    void scheduler::schedule_in(const u32& _event, const u64& _cycles)
+    {
+        schedule(_event, timestamp + _cycles);
+    }
+
+    void scheduler::cancel(const u32& _event)
+    {
+        slots[_event].order = SCHEDULER_NEVER;
+        slots[_event].timestamp = SCHEDULER_NEVER;
+    }
+
+    const bool scheduler::is_scheduled(const u32& _event)
+    {
+        return slots[_event].timestamp != SCHEDULER_NEVER;
+    }
+
+    const u64 scheduler::get_event_timestamp(const u32& _event)
+    {
+        return slots[_event].timestamp;
+    }
+
+    const u64 scheduler::get_timestamp()
+    {
+        return timestamp;
+    }
+
+    const u64 scheduler::get_next_timestamp()
+    {
+        drop_stale_entries();
+        return entries.empty() ? SCHEDULER_NEVER : entries.front().timestamp;
+    }
+
+    const u64 scheduler::get_cycles_to_next_event()
+    {
+        u64 nextTimestamp = get_next_timestamp();
+        return nextTimestamp > timestamp ? nextTimestamp - timestamp : 0;
+    }
+
+    void scheduler::advance(const u64& _cycles)
+    {
+        timestamp += _cycles;
+    }
+
+    void scheduler::run_events()
+    {
+        while (get_next_timestamp() <= timestamp)
+        {
+            scheduler_entry entry = entries.front();
+            std::pop_heap(entries.begin(), entries.end(), compare_entries);
+            entries.pop_back();
+
+            // unscheduled before the callback runs, so it can schedule itself again
+            cancel(entry.event);
+            slots[entry.event].callback(entry.timestamp);
+        }
+    }
+
+    void scheduler::reset()
+    {
+        timestamp = 0;
+        entries.clear();
+        for (scheduler_slot& slot : slots)
+        {
+            slot.order = SCHEDULER_NEVER;
+            slot.timestamp = SCHEDULER_NEVER;
+        }
+    }
+
+    void scheduler::drop_stale_entries()
+    {
+        while (!entries.empty() && !is_current(entries.front()))
+        {
+            std::pop_heap(entries.begin(), entries.end(), compare_entries);
+            entries.pop_back();
+        }
+    }
+
+    void scheduler::compact()
+    {
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [this](const scheduler_entry& _entry) { return !is_current(_entry); }), entries.end());
+        std::make_heap(entries.begin(), entries.end(), compare_entries);
+    }
+
+    const bool scheduler::is_current(const scheduler_entry& _entry)
+    {
+        return slots[_entry.event].order == _entry.order;
+    }
+
+    const bool scheduler::compare_entries(const scheduler_entry& _a, const scheduler_entry& _b)
+    {
+        // std heaps keep the largest element on top
+        if (_a.timestamp != _b.timestamp)
+            return _a.timestamp > _b.timestamp;
+        return _a.order > _b.order;
+    }
+
+    scheduler::scheduler()
+        : timestamp{ 0 }, nextOrder{ 0 }
+    {
+    }
+}
@@ -0,0 +1,177 @@
+#include "../include/timers.h"
+#include "../include/bus.h"
+#include "../include/scheduler.h"
+#include "../include/cpu.h"
+#include "../include/interrupt_controller.h"
+
+namespace br::gba
+{
+    void timers::reset()
+    {
+        for (u32 i = 0; i < TIMER_COUNT; ++i)
+        {
+            timer_state& timer = timerStates[i];
+            timer.reload = 0;
+            timer.control = 0;
+            timer.counter = 0;
+            timer.startTimestamp = 0;
+            systemScheduler.cancel(timer.overflowEvent);
+
+            addressBus.set_io_register(IO_TIMER_ADDR + i * IO_TIMER_STRIDE, 0);
+            addressBus.set_io_register(IO_TIMER_ADDR + i * IO_TIMER_STRIDE + 2, 0);
+        }
+    }
+
+    void timers::restore()
+    {
+        for (u32 i = 0; i < TIMER_COUNT; ++i)
+        {
+            timer_state& timer = timerStates[i];
+            timer.reload = addressBus.get_io_register(IO_TIMER_ADDR + i * IO_TIMER_STRIDE);
+            timer.control = addressBus.get_io_register(IO_TIMER_ADDR + i * IO_TIMER_STRIDE + 2) & TIMER_CONTROL_MASK;
+            timer.counter = timer.reload;
+            timer.startTimestamp = get_timestamp();
+
+            if (is_counting(i))
+                schedule_overflow(i);
+            else
+                systemScheduler.cancel(timer.overflowEvent);
+        }
+    }
+
+    const u16 timers::get_counter(const u32& _index)
+    {
+        return get_counter(_index, get_timestamp());
+    }
+
+    const u16 timers::get_interrupt_sources()
+    {
+        u16 sources = 0;
+        for (u32 i = 0; i < TIMER_COUNT; ++i)
+        {
+            u16 control = timerStates[i].control;
+            if ((control & TIMER_CONTROL_ENABLE) && (control & TIMER_CONTROL_IRQ))
+                sources |= IRQ_TIMER_0 << i;
+        }
+
+        return sources;
+    }
+
+    const u64 timers::get_timestamp()
+    {
+        return systemScheduler.get_timestamp() + systemCPU.get_run_cycles();
+    }
+
+    const bool timers::is_counting(const u32& _index)
+    {
+        u16 control = timerStates[_index].control;
+        bool isCascading = _index > 0 && (control & TIMER_CONTROL_CASCADE);
+        return (control & TIMER_CONTROL_ENABLE) && !isCascading;
+    }
+
+    const u16 timers::get_counter(const u32& _index, const u64& _timestamp)
+    {
+        timer_state& timer = timerStates[_index];
+        if (!is_counting(_index))
+            return timer.counter;
+
+        u64 ticks = (_timestamp - timer.startTimestamp) >> TIMER_PRESCALER_SHIFTS[timer.control & TIMER_CONTROL_PRESCALER_MASK];
+        u64 overflowTicks = TIMER_PERIOD - timer.counter;
+        if (ticks < overflowTicks)
+            return (u16)(timer.counter + ticks);
+
+        // read in the run that passed the overflow, before its event was handled
+        return (u16)(timer.reload + (ticks - overflowTicks) % (TIMER_PERIOD - timer.reload));
+    }
+
+    void timers::schedule_overflow(const u32& _index)
+    {
+        timer_state& timer = timerStates[_index];
+        u64 cycles = (u64)(TIMER_PERIOD - timer.counter) << TIMER_PRESCALER_SHIFTS[timer.control & TIMER_CONTROL_PRESCALER_MASK];
+        u64 overflowTimestamp = timer.startTimestamp + cycles;
+
+        // the cpu budget ends at the next event, an earlier overflow has to end the current run
+        if (overflowTimestamp < systemScheduler.get_next_timestamp())
+            systemCPU.end_run();
+
+        systemScheduler.schedule(timer.overflowEvent, overflowTimestamp);
+    }
+
+    void timers::overflow(const u32& _index, const u64& _timestamp)
+    {
+        timer_state& timer = timerStates[_index];
+        timer.counter = timer.reload;
+        timer.startTimestamp = _timestamp;
+        schedule_overflow(_index);
+
+        signal_overflow(_index);
+    }
+
+    void timers::signal_overflow(const u32& _index)
+    {
+        if (timerStates[_index].control & TIMER_CONTROL_IRQ)
+            systemInterrupts.request(IRQ_TIMER_0 << _index);
+
+        u32 next = _index + 1;
+        if (next == TIMER_COUNT)
+            return;
+
+        timer_state& nextTimer = timerStates[next];
+        if ((nextTimer.control & TIMER_CONTROL_ENABLE) && (nextTimer.control & TIMER_CONTROL_CASCADE) && ++nextTimer.counter == 0)
+        {
+            nextTimer.counter = nextTimer.reload;
+            signal_overflow(next);
+        }
+    }
+
+    const u16 timers::read_counter(const u32& _index, const u32& _offset)
+    {
+        return get_counter(_index, get_timestamp());
+    }
+
+    const u16 timers::write_reload(const u32& _index, const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        // the counter only takes the reload value when the timer is enabled or overflows
+        timerStates[_index].reload = (_previous & ~_mask) | _data;
+        return timerStates[_index].reload;
+    }
+
+    const u16 timers::write_control(const u32& _index, const u32& _offset, const u16& _previous, const u16& _data, const u16& _mask)
+    {
+        timer_state& timer = timerStates[_index];
+        u64 timestamp = get_timestamp();
+        timer.counter = get_counter(_index, timestamp);
+
+        bool wasEnabled = timer.control & TIMER_CONTROL_ENABLE;
+        timer.control = ((_previous & ~_mask) | _data) & TIMER_CONTROL_MASK;
+        if (!wasEnabled && (timer.control & TIMER_CONTROL_ENABLE))
+            timer.counter = timer.reload;
+
+        if (is_counting(_index))
+        {
+            timer.startTimestamp = timestamp;
+            schedule_overflow(_index);
+        }
+        else
+        {
+            systemScheduler.cancel(timer.overflowEvent);
+        }
+
+        return timer.control;
+    }
+
+    timers::timers(bus& _addressBus, scheduler& _systemScheduler, cpu& _systemCPU, interrupt_controller& _systemInterrupts)
+        : addressBus{ _addressBus }, systemScheduler{ _systemScheduler }, systemCPU{ _systemCPU }, systemInterrupts{ _systemInterrupts }, timerStates{}
+    {
+        for (u32 i = 0; i < TIMER_COUNT; ++i)
+        {
+            u32 address = IO_TIMER_ADDR + i * IO_TIMER_STRIDE;
+            timerStates[i].overflowEvent = systemScheduler.add_event(std::bind(&timers::overflow, this, i, std::placeholders::_1));
+
+            addressBus.set_io_handler(address, std::bind(&timers::read_counter, this, i, std::placeholders::_1),
+                std::bind(&timers::write_reload, this, i, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+            addressBus.set_io_handler(address + 2, nullptr,
+                std::bind(&timers::write_control, this, i, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        }
+    }
+}
@@ -0,0 +1,284 @@
+#include "../include/x64_emitter.h"
+#include <cstring>
+
+namespace br::gba
+{
+    void x64_emitter::reset(u8* _code, const std::size_t& _capacity)
+    {
+        code = _code;
+        capacity = _capacity;
+        size = 0;
+        overflowed = false;
+    }
+
+    u8* x64_emitter::get_code()
+    {
+        return code;
+    }
+
+    const std::size_t x64_emitter::get_size()
+    {
+        return size;
+    }
+
+    const bool x64_emitter::has_overflowed()
+    {
+        return overflowed;
+    }
+
+    void x64_emitter::alu(const x64_operation& _operation, const x64_register& _destination, const x64_register& _source, const bool& _wide)
+    {
+        encode(((u32)_operation << 3) | 0x01, _wide, (u8)_source, _destination);
+    }
+
+    void x64_emitter::alu(const x64_operation& _operation, const x64_register& _destination, const s32& _immediate, const bool& _wide)
+    {
+        bool isShort = _immediate >= -128 && _immediate <= 127;
+        encode(isShort ? 0x83 : 0x81, _wide, (u8)_operation, _destination);
+        if (isShort)
+            emit_8((u8)_immediate);
+        else
+            emit_32((u32)_immediate);
+    }
+
+    void x64_emitter::alu(const x64_operation& _operation, const x64_register& _destination, const x64_memory& _source, const bool& _wide)
+    {
+        encode(((u32)_operation << 3) | 0x03, _wide, (u8)_destination, _source);
+    }
+
+    void x64_emitter::alu(const x64_operation& _operation, const x64_memory& _destination, const x64_register& _source, const bool& _wide)
+    {
+        encode(((u32)_operation << 3) | 0x01, _wide, (u8)_source, _destination);
+    }
+
+    void x64_emitter::alu(const x64_operation& _operation, const x64_memory& _destination, const s32& _immediate, const bool& _wide)
+    {
+        bool isShort = _immediate >= -128 && _immediate <= 127;
+        encode(isShort ? 0x83 : 0x81, _wide, (u8)_operation, _destination);
+        if (isShort)
+            emit_8((u8)_immediate);
+        else
+            emit_32((u32)_immediate);
+    }
+
+    void x64_emitter::mov(const x64_register& _destination, const x64_register& _source, const bool& _wide)
+    {
+        encode(0x89, _wide, (u8)_source, _destination);
+    }
+
+    void x64_emitter::mov(const x64_register& _destination, const u32& _immediate)
+    {
+        // writing the low half clears the upper one
+        emit_rex(false, 0, 0, (u8)_destination);
+        emit_8(0xB8 | ((u8)_destination & 0b111));
+        emit_32(_immediate);
+    }
+
+    void x64_emitter::mov(const x64_register& _destination, const x64_memory& _source, const bool& _wide)
+    {
+        encode(0x8B, _wide, (u8)_destination, _source);
+    }
+
+    void x64_emitter::mov(const x64_memory& _destination, const x64_register& _source, const bool& _wide)
+    {
+        encode(0x89, _wide, (u8)_source, _destination);
+    }
+
+    void x64_emitter::mov(const x64_memory& _destination, const u32& _immediate)
+    {
+        encode(0xC7, false, 0, _destination);
+        emit_32(_immediate);
+    }
+
+    void x64_emitter::mov_64(const x64_register& _destination, const u64& _immediate)
+    {
+        emit_rex(true, 0, 0, (u8)_destination);
+        emit_8(0xB8 | ((u8)_destination & 0b111));
+        emit_32((u32)_immediate);
+        emit_32((u32)(_immediate >> 32));
+    }
+
+    void x64_emitter::mov_16(const x64_memory& _destination, const x64_register& _source)
+    {
+        // operand size prefix goes before rex
+        emit_8(0x66);
+        encode(0x89, false, (u8)_source, _destination);
+    }
+
+    void x64_emitter::mov_8(const x64_memory& _destination, const x64_register& _source)
+    {
+        encode(0x88, false, (u8)_source, _destination, true);
+    }
+
+    void x64_emitter::movzx_8(const x64_register& _destination, const x64_register& _source)
+    {
+        encode(0x0FB6, false, (u8)_destination, _source, true);
+    }
+
+    void x64_emitter::movzx_8(const x64_register& _destination, const x64_memory& _source)
+    {
+        encode(0x0FB6, false, (u8)_destination, _source);
+    }
+
+    void x64_emitter::movzx_16(const x64_register& _destination, const x64_memory& _source)
+    {
+        encode(0x0FB7, false, (u8)_destination, _source);
+    }
+
+    void x64_emitter::movsx_8(const x64_register& _destination, const x64_register& _source)
+    {
+        encode(0x0FBE, false, (u8)_destination, _source, true);
+    }
+
+    void x64_emitter::test(const x64_register& _destination, const x64_register& _source, const bool& _wide)
+    {
+        encode(0x85, _wide, (u8)_source, _destination);
+    }
+
+    void x64_emitter::test(const x64_register& _destination, const u32& _immediate)
+    {
+        encode(0xF7, false, 0, _destination);
+        emit_32(_immediate);
+    }
+
+    void x64_emitter::shift(const x64_shift& _shift, const x64_register& _destination, const u8& _amount, const bool& _wide)
+    {
+        encode(0xC1, _wide, (u8)_shift, _destination);
+        emit_8(_amount);
+    }
+
+    void x64_emitter::bt(const x64_register& _destination, const u8& _bit)
+    {
+        encode(0x0FBA, false, 4, _destination);
+        emit_8(_bit);
+    }
+
+    void x64_emitter::bt(const x64_register& _destination, const x64_register& _bit, const bool& _wide)
+    {
+        encode(0x0FA3, _wide, (u8)_bit, _destination);
+    }
+
+    void x64_emitter::setcc(const x64_condition& _condition, const x64_register& _destination)
+    {
+        encode(0x0F90 | (u8)_condition, false, 0, _destination, true);
+    }
+
+    void x64_emitter::not_(const x64_register& _destination)
+    {
+        encode(0xF7, false, 2, _destination);
+    }
+
+    void x64_emitter::push(const x64_register& _register)
+    {
+        emit_rex(false, 0, 0, (u8)_register);
+        emit_8(0x50 | ((u8)_register & 0b111));
+    }
+
+    void x64_emitter::pop(const x64_register& _register)
+    {
+        emit_rex(false, 0, 0, (u8)_register);
+        emit_8(0x58 | ((u8)_register & 0b111));
+    }
+
+    void x64_emitter::ret()
+    {
+        emit_8(0xC3);
+    }
+
+    void x64_emitter::call(const void* _function)
+    {
+        mov_64(x64_register::RAX, reinterpret_cast<u64>(_function));
+        encode(0xFF, false, 2, x64_register::RAX);
+    }
+
+    const std::size_t x64_emitter::jump()
+    {
+        emit_8(0xE9);
+        emit_32(0);
+        return size;
+    }
+
+    const std::size_t x64_emitter::jump(const x64_condition& _condition)
+    {
+        emit_8(0x0F);
+        emit_8(0x80 | (u8)_condition);
+        emit_32(0);
+        return size;
+    }
+
+    void x64_emitter::bind(const std::size_t& _label)
+    {
+        // the label is the end of the rel32 operand, jumps are relative to it
+        if (overflowed)
+            return;
+
+        u32 displacement = (u32)(size - _label);
+        std::memcpy(code + _label - sizeof(displacement), &displacement, sizeof(displacement));
+    }
+
+    void x64_emitter::emit_8(const u8& _data)
+    {
+        if (size >= capacity)
+        {
+            overflowed = true;
+            return;
+        }
+
+        code[size++] = _data;
+    }
+
+    void x64_emitter::emit_32(const u32& _data)
+    {
+        for (u32 i = 0; i < sizeof(_data); ++i)
+            emit_8((u8)(_data >> (i * 8)));
+    }
+
+    void x64_emitter::emit_rex(const bool& _wide, const u8& _reg, const u8& _index, const u8& _base, const bool& _force)
+    {
+        u8 rex = 0x40 | (_wide << 3) | ((_reg >> 3) << 2) | ((_index >> 3) << 1) | (_base >> 3);
+        if (rex != 0x40 || _force)
+            emit_8(rex);
+    }
+
+    void x64_emitter::emit_opcode(const u32& _opcode)
+    {
+        if (_opcode > 0xFF)
+            emit_8((u8)(_opcode >> 8));
+        emit_8((u8)_opcode);
+    }
+
+    void x64_emitter::encode(const u32& _opcode, const bool& _wide, const u8& _reg, const x64_register& _rm, const bool& _byteRegister)
+    {
+        u8 rm = (u8)_rm;
+        bool isLowByte = _byteRegister && ((_reg >= 4 && _reg < 8) || (rm >= 4 && rm < 8));
+        emit_rex(_wide, _reg, 0, rm, isLowByte);
+        emit_opcode(_opcode);
+        emit_8(0xC0 | ((_reg & 0b111) << 3) | (rm & 0b111));
+    }
+
+    void x64_emitter::encode(const u32& _opcode, const bool& _wide, const u8& _reg, const x64_memory& _rm, const bool& _byteRegister)
+    {
+        u8 base = (u8)_rm.base;
+        u8 index = _rm.hasIndex ? (u8)_rm.index : 0;
+        emit_rex(_wide, _reg, index, base, _byteRegister && _reg >= 4 && _reg < 8);
+        emit_opcode(_opcode);
+
+        // always a 32 bit displacement, rsp and r12 as base need a sib byte
+        if (_rm.hasIndex || (base & 0b111) == 0b100)
+        {
+            emit_8(0x84 | ((_reg & 0b111) << 3));
+            u8 sibIndex = _rm.hasIndex ? (index & 0b111) : 0b100;
+            emit_8((_rm.scale << 6) | (sibIndex << 3) | (base & 0b111));
+        }
+        else
+        {
+            emit_8(0x80 | ((_reg & 0b111) << 3) | (base & 0b111));
+        }
+        emit_32((u32)_rm.displacement);
+    }
+
+    x64_emitter::x64_emitter()
+        : code{ nullptr }, capacity{ 0 }, size{ 0 }, overflowed{ false }
+    {
+    }
+}
@@ -0,0 +1,75 @@
+IO_ADDR = 0x4000000
+IWRAM_ADDR = 0x3000000
+ROM_ADDR = 0x8000000
+MAX_WAKEUPS = 4
+
+; run with the system directive, timer 0 overflows every 256 cycles and its irq ends each halt
+; expected: r6 = 4, r9 = 0, [IWRAM_ADDR] = 8 (IF seen by the handler), [IWRAM_ADDR + 4] = 4 (handler calls),
+; [0x4000200] = 8 (IE set, IF acknowledged)
+
+mov r0, #0xD2
+msr cpsr_c, r0
+mov sp, IWRAM_ADDR
+add sp, #0x7F00
+
+mov r0, #0x1F
+msr cpsr_c, r0
+mov sp, IWRAM_ADDR
+add sp, #0x7E00
+
+; the bios calls the handler stored at 0x3FFFFFC
+mov r1, IWRAM_ADDR
+add r1, #0x8000
+mov r0, ROM_ADDR
+add r0, #0x84
+str r0, [r1, #-4]
+
+mov r4, IO_ADDR
+add r5, r4, #0x200
+
+; IE = timer 0, IME = 1
+mov r0, #8
+str r0, [r5]
+mov r0, #1
+str r0, [r5, #8]
+
+mov r2, IWRAM_ADDR
+mov r6, #0
+
+; timer 0 reloads 0xFF00, raises its irq and starts
+mov r0, #0xFF00
+orr r0, #0xC00000
+str r0, [r4, #0x100]
+
+_wait_for_irq:
+    strb r6, [r4, #0x301]
+
+    add r6, #1
+    cmp r6, MAX_WAKEUPS
+    bne _wait_for_irq
+
+mov r0, #0
+str r0, [r4, #0x100]
+ldrh r9, [r5, #2]
+
+_done:
+    mov r7, #2000
+    b _done
+
+_timer_irq:
+    mov r0, IO_ADDR
+    add r0, #0x200
+
+    ; writing IF back acknowledges the requested irqs, IE keeps its value
+    ldr r1, [r0]
+    str r1, [r0]
+
+    mov r2, IWRAM_ADDR
+    lsr r3, r1, #16
+    str r3, [r2]
+
+    ldr r3, [r2, #4]
+    add r3, #1
+    str r3, [r2, #4]
+
+    bx lr
\ No newline at end of file
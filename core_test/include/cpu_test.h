@@ -1,10 +1,25 @@
 #pragma once
 #include "gba_core.h"
+#include <array>
 #include <string>
 #include <vector>
 
 namespace br::gba
 {
+    // instructions and cycles of one run when the recompiler is tested
+    inline constexpr u64 TEST_BATCH_INSTRUCTIONS = 0x1000;
+    inline constexpr u32 TEST_BATCH_CYCLES = 0x10000000;
+
+    // the bios stub saves r0-r3, r12 and lr and calls the irq handler stored at 0x03FFFFFC like the bios does
+    inline constexpr u32 TEST_BIOS_IRQ_VECTOR = 0x18;
+    inline constexpr std::array<u32, 16> TEST_BIOS_IRQ_DISPATCHER =
+    {
+        0xE52DE004, 0xE52DC004, 0xE52D3004, 0xE52D2004, 0xE52D1004, 0xE52D0004, // str lr, r12, r3 - r0, [sp, #-4]!
+        0xE3A00301, 0xE3A0E03C, 0xE510F004,                                     // mov r0, #0x04000000; mov lr, #0x3C; ldr pc, [r0, #-4]
+        0xE49D0004, 0xE49D1004, 0xE49D2004, 0xE49D3004, 0xE49DC004, 0xE49DE004, // ldr r0 - r3, r12, lr, [sp], #4
+        0xE25EF004                                                              // subs pc, lr, #4
+    };
+
     struct memory_region
     {
         u32 address;
@@ -23,6 +38,26 @@ namespace br::gba
         void run();
         void load_directives_file(const std::string& _filePath);
 
+    private:
+        /// @brief run the program on the whole system, events and interrupts are handled between instructions
+        void run_system();
+
+        /// @brief test the register and memory breakpoints
+        /// @return a breakpoint was hit
+        const bool test_breakpoints(bus& _bus, cpu& _cpu);
+
+        /// @brief print the requested dumps, the run statistics and unmet expectations
+        void print_results(bus& _bus, cpu& _cpu, const u32& _instructions, const u64& _cycles, const long long& _milliseconds);
+
+        /// @brief write the bios stub and load the test rom
+        /// @return false if the rom could not be loaded
+        const bool load_program(bus& _bus, cpu& _cpu, const cpu_backend& _backend);
+
+        /// @brief run the program again on the interpreter and print where registers, cycles or memory differ
+        /// @param _instructions instructions the tested backend executed
+        /// @param _cycles cycles the tested backend emulated
+        void compare_with_interpreter(bus& _bus, cpu& _cpu, const u32& _instructions, const u64& _cycles);
+
     private:
         void set_rom_location(const tokensIterator& _first, const tokensIterator& _last);
         void set_output_location(const tokensIterator& _first, const tokensIterator& _last);
@@ -31,6 +66,15 @@ namespace br::gba
         void print_register_status(const tokensIterator& _first, const tokensIterator& _last);
         void set_register_breakpoint(const tokensIterator& _first, const tokensIterator& _last);
         void set_memory_breakpoint(const tokensIterator& _first, const tokensIterator& _last);
+        void set_interpreter_backend(const tokensIterator& _first, const tokensIterator& _last);
+        void set_recompiler_backend(const tokensIterator& _first, const tokensIterator& _last);
+        void set_interpreter_comparison(const tokensIterator& _first, const tokensIterator& _last);
+        void set_system_mode(const tokensIterator& _first, const tokensIterator& _last);
+        void set_register_expectation(const tokensIterator& _first, const tokensIterator& _last);
+        void set_memory_expectation(const tokensIterator& _first, const tokensIterator& _last);
+        void set_trace_level(const tokensIterator& _first, const tokensIterator& _last);
+        void set_fastmem(const tokensIterator& _first, const tokensIterator& _last);
+        void set_huge_pages(const tokensIterator& _first, const tokensIterator& _last);
     
     private:
         std::string romFilePath;
@@ -40,6 +84,18 @@ namespace br::gba
         std::vector<memory_region> printMemoryRegions;
         std::vector<breakpoint> breakpointsRegister;
         std::vector<breakpoint> breakpointsMemory;
+        cpu_backend cpuBackend;
+        // the same program is run on the interpreter and the results are compared
+        bool compareInterpreter;
+        // the program runs on a gba with its scheduler, timers and interrupts instead of a bare cpu
+        bool useSystem;
+        // values the registers and memory are checked against after the run
+        std::vector<breakpoint> expectedRegisters;
+        std::vector<breakpoint> expectedMemory;
+        // trace recorded when an output file is given
+        cpu_trace_level traceLevel;
+        bool useFastmem;
+        bool useHugePages;
 
     private:
         token_callbacks tokenCallbacks;
@@ -4,61 +4,244 @@
 #include <fstream>
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 
 namespace br::gba
 {
     void cpu_test::run()
     {
+        if (useSystem)
+        {
+            run_system();
+            return;
+        }
+
         std::chrono::high_resolution_clock timer;
         br::gba::bus gbaBus;
         br::gba::cpu gbaCPU(gbaBus);
 
-        gbaBus.write_32(0x0, 0xE3A00302);
-        gbaBus.write_32(0x4, 0xE12FFF10);
+        gbaBus.set_huge_pages(useHugePages);
+        if (useFastmem && !gbaBus.set_fastmem(true))
+            std::cout << "Fastmem not supported, using the page table" << std::endl;
 
-        if (!gbaBus.load_rom(romFilePath))
-        {
-            std::cout << "Could not load test ROM" << std::endl;
+        if (!load_program(gbaBus, gbaCPU, cpuBackend))
             return;
-        }
 
-        gbaCPU.reset();
+        gbaCPU.set_trace_level(outputFilePath.length() > 0 ? traceLevel : cpu_trace_level::OFF);
 
         u32 i = 0;
+        u64 emulatedCycles = 0;
         bool isBreak = false;
         auto cpuStart = timer.now();
+        // translated blocks only run in batches, breakpoints are tested after each block
+        bool isRecompiled = gbaCPU.get_backend() == cpu_backend::RECOMPILER;
+        bool isBatched = isRecompiled && breakpointsRegister.empty() && breakpointsMemory.empty();
         while ((cpuCycleMax == 0 || i <= cpuCycleMax) && !isBreak)
         {
-            gbaCPU.cycle();
-
-            for (const breakpoint& breakPoint : breakpointsRegister)
+            if (isRecompiled)
             {
-                isBreak |= gbaCPU.debug_get_register(breakPoint.index) == breakPoint.value;
-            }
+                u64 batch = cpuCycleMax == 0 ? TEST_BATCH_INSTRUCTIONS : std::min<u64>(TEST_BATCH_INSTRUCTIONS, cpuCycleMax + 1 - i);
+                u64 instructions = batch;
+                emulatedCycles += isBatched ? gbaCPU.run(TEST_BATCH_CYCLES, instructions) : gbaCPU.run_block(instructions);
+                i += (u32)(batch - instructions);
 
-            for (const breakpoint& breakPoint : breakpointsMemory)
+                // nothing runs on a halted cpu
+                isBreak = instructions == batch;
+            }
+            else
             {
-                isBreak |= gbaBus.read_32(breakPoint.index) == breakPoint.value;
+                emulatedCycles += gbaCPU.cycle();
+                i++;
             }
 
-            i++;
+            isBreak |= test_breakpoints(gbaBus, gbaCPU);
         }
         auto cpuEnd = timer.now();
 
+        auto totalMills = std::chrono::duration_cast<std::chrono::milliseconds>(cpuEnd - cpuStart).count();
+        print_results(gbaBus, gbaCPU, i, emulatedCycles, totalMills);
+
+        if (compareInterpreter)
+            compare_with_interpreter(gbaBus, gbaCPU, i, emulatedCycles);
+    }
+
+    void cpu_test::run_system()
+    {
+        std::chrono::high_resolution_clock timer;
+        br::gba::gba gbaSystem;
+        bus& gbaBus = gbaSystem.get_bus();
+        cpu& gbaCPU = gbaSystem.get_cpu();
+
+        gbaBus.set_huge_pages(useHugePages);
+        if (useFastmem && !gbaBus.set_fastmem(true))
+            std::cout << "Fastmem not supported, using the page table" << std::endl;
+
+        if (!load_program(gbaBus, gbaCPU, cpuBackend))
+            return;
+
+        gbaCPU.set_trace_level(outputFilePath.length() > 0 ? traceLevel : cpu_trace_level::OFF);
+
+        u32 i = 0;
+        bool isBreak = false;
+        auto cpuStart = timer.now();
+        // events run between the instructions of a batch, breakpoints need one instruction per batch
+        bool isStepped = !breakpointsRegister.empty() || !breakpointsMemory.empty();
+        while ((cpuCycleMax == 0 || i <= cpuCycleMax) && !isBreak)
+        {
+            u64 batch = isStepped ? 1 : (cpuCycleMax == 0 ? TEST_BATCH_INSTRUCTIONS : std::min<u64>(TEST_BATCH_INSTRUCTIONS, cpuCycleMax + 1 - i));
+            u64 timestamp = gbaSystem.get_timestamp();
+            gbaSystem.run_instructions(batch);
+
+            // run_instructions returns right away on a halt nothing can wake, the batch that halted counts in full
+            isBreak = gbaCPU.is_halted() && gbaSystem.get_timestamp() == timestamp;
+            if (!isBreak)
+                i += (u32)batch;
+
+            isBreak |= test_breakpoints(gbaBus, gbaCPU);
+        }
+        auto cpuEnd = timer.now();
+
+        auto totalMills = std::chrono::duration_cast<std::chrono::milliseconds>(cpuEnd - cpuStart).count();
+        print_results(gbaBus, gbaCPU, i, gbaSystem.get_timestamp(), totalMills);
+
+        if (compareInterpreter)
+            std::cout << "Comparing with the interpreter needs a bare cpu, it is skipped for system runs" << std::endl;
+    }
+
+    const bool cpu_test::test_breakpoints(bus& _bus, cpu& _cpu)
+    {
+        bool isBreak = false;
+        for (const breakpoint& breakPoint : breakpointsRegister)
+        {
+            isBreak |= _cpu.debug_get_register(breakPoint.index) == breakPoint.value;
+        }
+
+        for (const breakpoint& breakPoint : breakpointsMemory)
+        {
+            isBreak |= _bus.read_32(breakPoint.index) == breakPoint.value;
+        }
+
+        return isBreak;
+    }
+
+    void cpu_test::print_results(bus& _bus, cpu& _cpu, const u32& _instructions, const u64& _cycles, const long long& _milliseconds)
+    {
         for (const memory_region& region : printMemoryRegions)
         {
             for (u32 i = 0; i < region.count; ++i)
-                std::cout << gbaBus.debug_print_memory(region.address + (i * 4));
+                std::cout << _bus.debug_print_memory(region.address + (i * 4));
         }
 
         if (printRegisterStatus)
-            std::cout << gbaCPU.debug_print_status();
+            std::cout << _cpu.debug_print_status();
 
-        auto totalMills = std::chrono::duration_cast<std::chrono::milliseconds>(cpuEnd - cpuStart).count();
-        std::cout << "Total cycles: " << i << ", Time taken: " << totalMills << "ms" << std::endl;
+        std::cout << "Total cycles: " << _instructions << ", Emulated cycles: " << _cycles << ", Time taken: " << _milliseconds << "ms" << std::endl;
         
         if (outputFilePath.length() > 0)
-            gbaCPU.debug_save_log(outputFilePath);
+            _cpu.debug_save_log(outputFilePath);
+
+        u32 failedCount = 0;
+        for (const breakpoint& expected : expectedRegisters)
+        {
+            u32 value = _cpu.debug_get_register(expected.index);
+            if (value == expected.value)
+                continue;
+
+            std::cout << "Expected register " << std::dec << expected.index << " to be 0x" << std::hex << expected.value << ", got 0x" << value << std::dec << std::endl;
+            failedCount++;
+        }
+
+        for (const breakpoint& expected : expectedMemory)
+        {
+            u32 value = _bus.read_32(expected.index);
+            if (value == expected.value)
+                continue;
+
+            std::cout << "Expected memory at 0x" << std::hex << expected.index << " to be 0x" << expected.value << ", got 0x" << value << std::dec << std::endl;
+            failedCount++;
+        }
+
+        u32 expectedCount = (u32)(expectedRegisters.size() + expectedMemory.size());
+        if (expectedCount != 0)
+            std::cout << "Expectations met: " << expectedCount - failedCount << " of " << expectedCount << std::endl;
+    }
+
+    const bool cpu_test::load_program(bus& _bus, cpu& _cpu, const cpu_backend& _backend)
+    {
+        _bus.write_32(0x0, 0xE3A00302);
+        _bus.write_32(0x4, 0xE12FFF10);
+
+        _bus.write_block_32(TEST_BIOS_IRQ_VECTOR, TEST_BIOS_IRQ_DISPATCHER.data(), (u32)TEST_BIOS_IRQ_DISPATCHER.size());
+
+        if (!_bus.load_rom(romFilePath))
+        {
+            std::cout << "Could not load test ROM" << std::endl;
+            return false;
+        }
+
+        _cpu.set_backend(_backend);
+        _cpu.reset();
+        return true;
+    }
+
+    void cpu_test::compare_with_interpreter(bus& _bus, cpu& _cpu, const u32& _instructions, const u64& _cycles)
+    {
+        br::gba::bus referenceBus;
+        br::gba::cpu referenceCPU(referenceBus);
+        if (!load_program(referenceBus, referenceCPU, cpu_backend::INTERPRETER))
+            return;
+
+        // the reference runs as many instructions, breakpoints of the tested backend can stop after a whole block
+        u64 instructions = _instructions;
+        u64 referenceCycles = 0;
+        while (instructions != 0)
+        {
+            u64 batch = instructions;
+            referenceCycles += referenceCPU.run(TEST_BATCH_CYCLES, instructions);
+
+            // nothing runs on a halted cpu
+            if (instructions == batch)
+                break;
+        }
+
+        bool isMatch = true;
+        std::string status = _cpu.debug_print_status();
+        std::string referenceStatus = referenceCPU.debug_print_status();
+        if (status != referenceStatus)
+        {
+            std::cout << "Registers differ from the interpreter, interpreter status:\n" << referenceStatus;
+            isMatch = false;
+        }
+
+        if (_cycles != referenceCycles)
+        {
+            std::cout << "Emulated cycles differ from the interpreter: " << _cycles << ", interpreter: " << referenceCycles << std::endl;
+            isMatch = false;
+        }
+
+        std::vector<u8> memory;
+        std::vector<u8> referenceMemory;
+        _bus.save_memory_state(memory);
+        referenceBus.save_memory_state(referenceMemory);
+        u32 differentBytes = 0;
+        u32 firstDifference = 0;
+        for (u32 i = 0; i < memory.size(); ++i)
+        {
+            if (memory[i] == referenceMemory[i])
+                continue;
+
+            if (differentBytes++ == 0)
+                firstDifference = i;
+        }
+
+        if (differentBytes != 0)
+        {
+            std::cout << "Memory differs from the interpreter in " << std::dec << differentBytes << " bytes, first at arena offset 0x" << std::hex << firstDifference << std::dec << std::endl;
+            isMatch = false;
+        }
+
+        if (isMatch)
+            std::cout << "Registers, cycles and memory match the interpreter" << std::endl;
     }
 
     void cpu_test::load_directives_file(const std::string& _filePath)
@@ -120,7 +303,64 @@ namespace br::gba
         breakpointsMemory.push_back(breakPoint);
     }
 
+    void cpu_test::set_interpreter_backend(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        cpuBackend = cpu_backend::INTERPRETER;
+    }
+
+    void cpu_test::set_recompiler_backend(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        cpuBackend = cpu_backend::RECOMPILER;
+    }
+
+    void cpu_test::set_interpreter_comparison(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        compareInterpreter = true;
+    }
+
+    void cpu_test::set_system_mode(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        useSystem = true;
+    }
+
+    void cpu_test::set_register_expectation(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        breakpoint expected;
+        expected.index = std::stol(*(_last - 1));
+        expected.value = std::stol(*_last);
+        expectedRegisters.push_back(expected);
+    }
+
+    void cpu_test::set_memory_expectation(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        breakpoint expected;
+        expected.index = std::stol(*(_last - 1));
+        expected.value = std::stol(*_last);
+        expectedMemory.push_back(expected);
+    }
+
+    void cpu_test::set_trace_level(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        if (*_last == "off")
+            traceLevel = cpu_trace_level::OFF;
+        else if (*_last == "opcode")
+            traceLevel = cpu_trace_level::OPCODE;
+        else
+            traceLevel = cpu_trace_level::FULL;
+    }
+
+    void cpu_test::set_fastmem(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        useFastmem = true;
+    }
+
+    void cpu_test::set_huge_pages(const tokensIterator& _first, const tokensIterator& _last)
+    {
+        useHugePages = true;
+    }
+
     cpu_test::cpu_test()
+        : cpuBackend{ cpu_backend::CACHED }, compareInterpreter{ false }, useSystem{ false }, traceLevel{ cpu_trace_level::FULL }, useFastmem{ false }, useHugePages{ false }
     {
         tokenCallbacks = 
         {
@@ -130,7 +370,16 @@ namespace br::gba
             { "memdump", 2, std::bind(&cpu_test::print_memory_region, this, std::placeholders::_1, std::placeholders::_2) },
             { "regdump", 0, std::bind(&cpu_test::print_register_status, this, std::placeholders::_1, std::placeholders::_2) },
             { "regbreak", 2, std::bind(&cpu_test::set_register_breakpoint, this, std::placeholders::_1, std::placeholders::_2) },
-            { "membreak", 2, std::bind(&cpu_test::set_memory_breakpoint, this, std::placeholders::_1, std::placeholders::_2) }
+            { "membreak", 2, std::bind(&cpu_test::set_memory_breakpoint, this, std::placeholders::_1, std::placeholders::_2) },
+            { "interpret", 0, std::bind(&cpu_test::set_interpreter_backend, this, std::placeholders::_1, std::placeholders::_2) },
+            { "recompile", 0, std::bind(&cpu_test::set_recompiler_backend, this, std::placeholders::_1, std::placeholders::_2) },
+            { "compare", 0, std::bind(&cpu_test::set_interpreter_comparison, this, std::placeholders::_1, std::placeholders::_2) },
+            { "system", 0, std::bind(&cpu_test::set_system_mode, this, std::placeholders::_1, std::placeholders::_2) },
+            { "regexpect", 2, std::bind(&cpu_test::set_register_expectation, this, std::placeholders::_1, std::placeholders::_2) },
+            { "memexpect", 2, std::bind(&cpu_test::set_memory_expectation, this, std::placeholders::_1, std::placeholders::_2) },
+            { "trace", 1, std::bind(&cpu_test::set_trace_level, this, std::placeholders::_1, std::placeholders::_2) },
+            { "fastmem", 0, std::bind(&cpu_test::set_fastmem, this, std::placeholders::_1, std::placeholders::_2) },
+            { "hugepages", 0, std::bind(&cpu_test::set_huge_pages, this, std::placeholders::_1, std::placeholders::_2) }
         };
     }
 }
\ No newline at end of file